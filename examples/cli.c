@@ -51,12 +51,16 @@ static void cmd_rm(int argc, char **argv);
 static void cmd_cp(int argc, char **argv);
 static void cmd_mv(int argc, char **argv);
 static void cmd_stat(int argc, char **argv);
+static void cmd_archive(int argc, char **argv);
 static void cmd_format(int argc, char **argv);
 static void cmd_mount(int argc, char **argv);
 static void cmd_unmount(int argc, char **argv);
 static void cmd_status(int argc, char **argv);
 static void cmd_motor(int argc, char **argv);
 static void cmd_select(int argc, char **argv);
+static void cmd_splice(int argc, char **argv);
+static void cmd_history(int argc, char **argv);
+static void cmd_park(int argc, char **argv);
 static void cmd_home(int argc, char **argv);
 static void cmd_pins(int argc, char **argv);
 static void cmd_poll(int argc, char **argv);
@@ -83,12 +87,16 @@ static const cmd_entry_t commands[] = {
   {"cp",      NULL,    cmd_cp,      true,  "cp <src> <dst>",      "Copy file"},
   {"mv",      NULL,    cmd_mv,      true,  "mv <src> <dst>",      "Move/rename file"},
   {"stat",    NULL,    cmd_stat,    true,  "stat <file>",         "File details and cluster chain"},
+  {"archive", NULL,    cmd_archive, true,  "archive [1|2]",       "Parity archival status / enable"},
   {"format",  NULL,    cmd_format,  false, "format [label] [full]","Format disk"},
   {"mount",   NULL,    cmd_mount,   false, "mount",               "Mount filesystem"},
   {"unmount", "umount",cmd_unmount, false, "unmount",             "Unmount filesystem"},
   {"status",  "info",  cmd_status,  false, "status",              "Drive status and disk info"},
   {"motor",   NULL,    cmd_motor,   false, "motor [on|off]",      "Control motor"},
   {"select",  "sel",   cmd_select,  false, "select [on|off]",     "Control drive select"},
+  {"splice",  NULL,    cmd_splice,  false, "splice [on|off]",     "Index-free track writes"},
+  {"history", NULL,    cmd_history, false, "history [reset]",     "Per-track recovery history"},
+  {"park",    NULL,    cmd_park,    false, "park [stay|track0|median|now]", "Idle head parking policy"},
   {"home",    NULL,    cmd_home,    false, "home",                "Seek to track 0"},
   {"pins",    "gpio",  cmd_pins,    false, "pins",                "Read all GPIO pin states"},
   {"poll",    NULL,    cmd_poll,    false, "poll",                "Poll read_data + index (no PIO)"},
@@ -111,22 +119,28 @@ static const cmd_entry_t commands[] = {
 static f12_err_t do_mount(void) {
   f12_io_t io = {
     .read = floppy_io_read,
+    .read_quick = floppy_io_read_quick,
     .read_track = floppy_io_read_track,
     .write = floppy_io_write,
     .disk_changed = floppy_io_disk_changed,
     .write_protected = floppy_io_write_protected,
+    .set_sink = floppy_io_set_sink,
     .ctx = &floppy,
   };
-  return f12_mount(&fs, io);
+  f12_err_t err = f12_mount(&fs, io);
+  if (err == F12_OK) f12_set_alloc_policy(&fs, FAT12_ALLOC_LOCALITY);
+  return err;
 }
 
 static void setup_io(void) {
   fs.io = (f12_io_t){
     .read = floppy_io_read,
+    .read_quick = floppy_io_read_quick,
     .read_track = floppy_io_read_track,
     .write = floppy_io_write,
     .disk_changed = floppy_io_disk_changed,
     .write_protected = floppy_io_write_protected,
+    .set_sink = floppy_io_set_sink,
     .ctx = &floppy,
   };
 }
@@ -185,9 +199,9 @@ static int cli_readline(char *buf, int max) {
   memset(buf, 0, max);
 
   for (;;) {
-    int c = getchar();
-    if (c == EOF) {
-      tight_loop_contents();
+    int c = getchar_timeout_us(100000);
+    if (c == PICO_ERROR_TIMEOUT || c == EOF) {
+      floppy_idle(&floppy);
       continue;
     }
 
@@ -351,7 +365,11 @@ static void read_track_stats(int track, int side, track_stats_t *stats) {
       stats->long_count++;
     }
 
-    mfm_feed(&mfm, delta, &sector);
+    if (mfm_feed(&mfm, delta, &sector) && sector.valid &&
+        sector.track == track && sector.side == side &&
+        sector.sector_n >= 1 && sector.sector_n <= SECTORS_PER_TRACK) {
+      floppy_sink_sector(&floppy, &sector);
+    }
     prev = cnt;
   }
 
@@ -609,6 +627,7 @@ static void cmd_cp(int argc, char **argv) {
     f12_close(rf);
     return;
   }
+  f12_set_size_hint(wf, rf->dirent.size);
 
   uint32_t total = 0;
   int n;
@@ -650,6 +669,7 @@ static void cmd_mv(int argc, char **argv) {
     f12_close(rf);
     return;
   }
+  f12_set_size_hint(wf, rf->dirent.size);
 
   uint32_t total = 0;
   int n;
@@ -724,6 +744,39 @@ static void cmd_stat(int argc, char **argv) {
   }
 }
 
+static void cmd_archive(int argc, char **argv) {
+  if (argc < 2) {
+    if (!fs.archive.level) {
+      printf("Archival off\n");
+      return;
+    }
+    if (fs.archive.stale) {
+      printf("Archival level %d: parity is stale, run 'archive %d' to rebuild it\n",
+             fs.archive.level, fs.archive.level);
+      return;
+    }
+    const f12_archive_stats_t *st = &fs.archive.stats;
+    printf("Archival level %d: parity on cylinders %d-%d, %d pending\n",
+           fs.archive.level, fs.archive.first_cylinder, FLOPPY_TRACKS - 1, fs.archive.pending_count);
+    printf("  %lu parity track writes, %lu quick read fails, %lu rebuilt, %lu rebuild fails\n",
+           (unsigned long)st->parity_writes, (unsigned long)st->quick_fails,
+           (unsigned long)st->rebuilt, (unsigned long)st->rebuild_fails);
+    return;
+  }
+  int level = atoi(argv[1]);
+  uint8_t cyls = f12_archive_cylinders(level);
+  if (!cyls) {
+    printf("Usage: archive [1|2]\n");
+    return;
+  }
+  printf("Reserving cylinders %d-%d and writing parity...\n", FLOPPY_TRACKS - cyls, FLOPPY_TRACKS - 1);
+  f12_err_t err = f12_archive_enable(&fs, level);
+  if (err != F12_OK)
+    printf("Error: %s\n", f12_strerror(err));
+  else
+    printf("Archival level %d enabled\n", level);
+}
+
 static void cmd_format(int argc, char **argv) {
   const char *label = "PICODISK";
   bool full = false;
@@ -880,6 +933,78 @@ static void cmd_select(int argc, char **argv) {
   }
 }
 
+static void cmd_splice(int argc, char **argv) {
+  if (argc < 2) {
+    printf("Index-free writes are %s\n", floppy.index_free_write ? "ON" : "off");
+    return;
+  }
+  if (strcasecmp(argv[1], "on") == 0) {
+    floppy.index_free_write = true;
+    printf("Index-free writes ON\n");
+  } else if (strcasecmp(argv[1], "off") == 0) {
+    floppy.index_free_write = false;
+    printf("Index-free writes off\n");
+  } else {
+    printf("Usage: splice [on|off]\n");
+  }
+}
+
+static void cmd_history(int argc, char **argv) {
+  if (argc > 1 && strcasecmp(argv[1], "reset") == 0) {
+    floppy_reset_history(&floppy);
+    printf("Recovery history cleared\n");
+    return;
+  }
+  static const char *names[FLOPPY_RECOVER_COUNT] = {"read", "jog10", "jog20", "write", "recal"};
+  int shown = 0;
+  for (int t = 0; t < FLOPPY_TRACKS; t++) {
+    for (int s = 0; s < 2; s++) {
+      const floppy_history_t *h = floppy_track_history(&floppy, t, s);
+      bool any = h->total_revs > 0;
+      for (int r = 0; r < FLOPPY_RECOVER_COUNT; r++)
+        if (h->ok[r] || h->fail[r]) any = true;
+      if (!any) continue;
+      printf("T%02d/%d revs=%-4u margin=%3u%%", t, s, h->total_revs, h->margin);
+      for (int r = 0; r < FLOPPY_RECOVER_COUNT; r++) {
+        if (h->ok[r] || h->fail[r])
+          printf(" %s=%u/%u", names[r], h->ok[r], h->fail[r]);
+      }
+      printf("\n");
+      shown++;
+    }
+  }
+  if (shown == 0) printf("No recovery history\n");
+}
+
+static void cmd_park(int argc, char **argv) {
+  static const char *names[] = {"stay", "track0", "median"};
+  if (argc > 1) {
+    if (strcasecmp(argv[1], "stay") == 0) {
+      floppy.park_policy = FLOPPY_PARK_STAY;
+    } else if (strcasecmp(argv[1], "track0") == 0) {
+      floppy.park_policy = FLOPPY_PARK_TRACK0;
+    } else if (strcasecmp(argv[1], "median") == 0) {
+      floppy.park_policy = FLOPPY_PARK_MEDIAN;
+    } else if (strcasecmp(argv[1], "now") == 0) {
+      floppy_status_t st = floppy_park(&floppy);
+      if (st != FLOPPY_OK) printf("Park error: %d\n", st);
+    } else {
+      printf("Usage: park [stay|track0|median|now]\n");
+      return;
+    }
+  }
+
+  const floppy_seek_stats_t *st = &floppy.seek_stats;
+  printf("Policy: %s, target track %u, head at %u%s\n", names[floppy.park_policy],
+         floppy_park_target(&floppy), floppy_current_track(&floppy),
+         floppy.parked ? " (parked)" : "");
+  printf("Seeks: %lu, mean distance %.2f tracks\n", (unsigned long)st->seeks,
+         st->seeks ? (double)st->seek_steps / st->seeks : 0.0);
+  printf("Parks: %lu, %lu steps, saved %ld steps (%.2f per seek)\n",
+         (unsigned long)st->parks, (unsigned long)st->park_steps, (long)st->saved_steps,
+         st->seeks ? (double)st->saved_steps / st->seeks : 0.0);
+}
+
 static void cmd_home(int argc, char **argv) {
   (void)argc; (void)argv;
   printf("Seeking to track 0...\n");
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "drive_emu.h"
+
+// ============== Configuration ==============
+
+// 1.44MB image written to flash with e.g.
+//   picotool load -o 0x10100000 disk.img
+#define IMAGE_FLASH_OFFSET (1024 * 1024)
+#define IMAGE_SECTORS      (FLOPPY_TRACKS * 2 * SECTORS_PER_TRACK)
+#define DIRTY_MAX          72
+#define SECTORS_PER_BLOCK  (FLASH_SECTOR_SIZE / SECTOR_SIZE)
+// Flush everything once a further full-track write might not fit
+#define DIRTY_HIGH_WATER   (DIRTY_MAX - SECTORS_PER_TRACK)
+
+static drive_emu_t emu;
+
+// ============== Flash image with RAM write overlay ==============
+//
+// Flash can't be erased while the flux stream runs from XIP, so host
+// writes land in a RAM overlay. Between write gates, every flash block
+// the host has completely rewritten is flushed at once, and the whole
+// overlay is flushed when it passes the high-water mark or the motor
+// stops. A flush stalls the stream for one erase, which the host sees
+// as a missed revolution at worst. Each write gate carries at most one
+// track, so the overlay never has to refuse a sector.
+
+typedef struct {
+  uint16_t lba;
+  bool used;
+  uint8_t data[SECTOR_SIZE];
+} dirty_sector_t;
+
+static dirty_sector_t dirty[DIRTY_MAX];
+static uint8_t block_buf[FLASH_SECTOR_SIZE];
+
+static const uint8_t *image_sector(uint16_t lba) {
+  return (const uint8_t *)(XIP_BASE + IMAGE_FLASH_OFFSET) + (uint32_t)lba * SECTOR_SIZE;
+}
+
+static uint16_t image_lba(uint8_t track, uint8_t side, uint8_t sector_n) {
+  return (track * 2 + side) * SECTORS_PER_TRACK + sector_n - 1;
+}
+
+static dirty_sector_t *dirty_find(uint16_t lba) {
+  for (int i = 0; i < DIRTY_MAX; i++) {
+    if (dirty[i].used && dirty[i].lba == lba) return &dirty[i];
+  }
+  return NULL;
+}
+
+static bool image_read(void *ctx, uint8_t track, uint8_t side, uint8_t sector_n, uint8_t *data) {
+  (void)ctx;
+  uint16_t lba = image_lba(track, side, sector_n);
+  if (lba >= IMAGE_SECTORS) return false;
+  dirty_sector_t *d = dirty_find(lba);
+  memcpy(data, d ? d->data : image_sector(lba), SECTOR_SIZE);
+  return true;
+}
+
+static bool image_write(void *ctx, uint8_t track, uint8_t side, uint8_t sector_n, const uint8_t *data) {
+  (void)ctx;
+  uint16_t lba = image_lba(track, side, sector_n);
+  if (lba >= IMAGE_SECTORS) return false;
+  dirty_sector_t *d = dirty_find(lba);
+  for (int i = 0; !d && i < DIRTY_MAX; i++) {
+    if (!dirty[i].used) d = &dirty[i];
+  }
+  if (!d) return false;
+  d->lba = lba;
+  d->used = true;
+  memcpy(d->data, data, SECTOR_SIZE);
+  return true;
+}
+
+static int dirty_count(void) {
+  int n = 0;
+  for (int i = 0; i < DIRTY_MAX; i++) {
+    if (dirty[i].used) n++;
+  }
+  return n;
+}
+
+static void image_flush_block(uint16_t first) {
+  for (int s = 0; s < SECTORS_PER_BLOCK; s++) {
+    dirty_sector_t *d = dirty_find(first + s);
+    memcpy(block_buf + s * SECTOR_SIZE, d ? d->data : image_sector(first + s), SECTOR_SIZE);
+    if (d) d->used = false;
+  }
+
+  uint32_t offset = IMAGE_FLASH_OFFSET + (uint32_t)first * SECTOR_SIZE;
+  uint32_t irq = save_and_disable_interrupts();
+  flash_range_erase(offset, FLASH_SECTOR_SIZE);
+  flash_range_program(offset, block_buf, FLASH_SECTOR_SIZE);
+  restore_interrupts(irq);
+}
+
+static bool block_complete(uint16_t first) {
+  for (int s = 0; s < SECTORS_PER_BLOCK; s++) {
+    if (!dirty_find(first + s)) return false;
+  }
+  return true;
+}
+
+static int image_flush(bool complete_only) {
+  int blocks = 0;
+  for (int i = 0; i < DIRTY_MAX; i++) {
+    if (!dirty[i].used) continue;
+    uint16_t first = dirty[i].lba - dirty[i].lba % SECTORS_PER_BLOCK;
+    if (complete_only && !block_complete(first)) continue;
+    image_flush_block(first);
+    blocks++;
+  }
+  return blocks;
+}
+
+// ============== Main ==============
+
+int main(void) {
+#if PICO_RP2040
+  // Same clock as the CLI so the PIO dividers are exact integers
+  set_sys_clock_khz(144000, true);
+#endif
+  stdio_init_all();
+  sleep_ms(2000);
+
+  printf("\r\n\r\n=== Pico Floppy Drive Emulator ===\r\n");
+
+  // Same GPIOs as the CLI, seen from the host controller's side of the cable
+  emu = (drive_emu_t){
+    .pins = {
+      .index         = 14,
+      .track0        = 5,
+      .write_protect = 4,
+      .read_data     = 3,
+      .disk_change   = 1,
+      .drive_select  = 12,
+      .motor_enable  = 10,
+      .direction     = 9,
+      .step          = 8,
+      .write_data    = 7,
+      .write_gate    = 6,
+      .side_select   = 2,
+    }
+  };
+
+  drive_emu_init(&emu);
+  drive_emu_image_t image = { .read = image_read, .write = image_write, .ctx = NULL };
+  drive_emu_change_disk(&emu, image, false);
+
+  printf("Serving 1.44MB image from flash offset 0x%x\r\n", IMAGE_FLASH_OFFSET);
+
+  bool motor_was_on = false;
+  uint32_t written = 0;
+  uint32_t checked = 0;
+  for (;;) {
+    drive_emu_poll(&emu);
+
+    if (!emu.writing && emu.stats.sectors_written != checked) {
+      checked = emu.stats.sectors_written;
+      image_flush(dirty_count() <= DIRTY_HIGH_WATER);
+    }
+
+    if (motor_was_on && !emu.motor_on && emu.stats.sectors_written != written) {
+      written = emu.stats.sectors_written;
+      int blocks = image_flush(false);
+      printf("Flushed %d flash blocks (%lu sectors written, %lu errors, %lu revolutions)\r\n",
+             blocks, (unsigned long)emu.stats.sectors_written,
+             (unsigned long)emu.stats.write_errors, (unsigned long)emu.stats.revolutions);
+    }
+    motor_was_on = emu.motor_on;
+  }
+}
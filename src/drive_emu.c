@@ -0,0 +1,367 @@
+#include "drive_emu.h"
+#include "crc.h"
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "flux_read.pio.h"
+#include "flux_write.pio.h"
+
+#define SECTOR_MARKS_OFF 12
+#define SECTOR_ID_OFF 15
+#define SECTOR_GAP2_OFF 22
+#define SECTOR_DATA_SYNC_OFF 44
+#define SECTOR_DATA_MARKS_OFF 56
+#define SECTOR_MARK_OFF 59
+#define SECTOR_DATA_OFF 60
+#define SECTOR_CRC_OFF 572
+#define SECTOR_GAP3_OFF 574
+
+static void gpio_put_oc(uint pin, bool value) {
+  if (value == 0) {
+    gpio_put(pin, 0);
+    gpio_set_dir(pin, GPIO_OUT);
+  } else {
+    gpio_set_dir(pin, GPIO_IN);
+  }
+}
+
+static uint16_t drive_emu_angle_byte(drive_emu_t *e) {
+  return (e->angle / DRIVE_EMU_BYTE_COUNTS) % MFM_TRACK_BYTES;
+}
+
+static void drive_emu_resync(drive_emu_t *e) {
+  e->head = e->tail;
+  e->index_pending = false;
+  e->pos = (drive_emu_angle_byte(e) + 1) % MFM_TRACK_BYTES;
+  e->resync = true;
+  e->enc.prev_bit = 0;
+  e->enc.pending_cells = 0;
+  e->stats.resyncs++;
+}
+
+static bool drive_emu_boundary(uint16_t pos) {
+  if (pos < DRIVE_EMU_LEAD_GAP) return pos == 0;
+  if (pos >= DRIVE_EMU_SECTORS_END) return pos == DRIVE_EMU_SECTORS_END;
+  return (pos - DRIVE_EMU_LEAD_GAP) % DRIVE_EMU_SECTOR_BYTES == 0;
+}
+
+static uint16_t drive_emu_gap(drive_emu_t *e, uint16_t until) {
+  uint16_t n = until - e->pos;
+  if (n > DRIVE_EMU_PIECE_BYTES) n = DRIVE_EMU_PIECE_BYTES;
+  mfm_encode_gap(&e->enc, n);
+  return n;
+}
+
+static uint16_t drive_emu_preamble(drive_emu_t *e, uint16_t until) {
+  static const uint8_t zeros[DRIVE_EMU_PIECE_BYTES] = {0};
+  uint16_t n = until - e->pos;
+  if (n > DRIVE_EMU_PIECE_BYTES) n = DRIVE_EMU_PIECE_BYTES;
+  mfm_encode_bytes(&e->enc, zeros, n);
+  return n;
+}
+
+static uint16_t drive_emu_sector_piece(drive_emu_t *e, uint8_t s, uint16_t off) {
+  uint16_t block = e->pos - off;
+
+  if (off == 0) {
+    e->sector_ok = e->image.read &&
+                   e->image.read(e->image.ctx, e->cylinder, e->side, s + 1, e->sector_data);
+    if (e->sector_ok) {
+      e->stats.sectors_streamed++;
+    } else {
+      e->stats.sectors_missing++;
+    }
+  }
+  if (!e->sector_ok) return drive_emu_gap(e, block + DRIVE_EMU_SECTOR_BYTES);
+
+  if (off < SECTOR_MARKS_OFF) return drive_emu_preamble(e, block + SECTOR_MARKS_OFF);
+  if (off == SECTOR_MARKS_OFF || off == SECTOR_DATA_MARKS_OFF) {
+    mfm_encode_marks(&e->enc);
+    return SECTOR_ID_OFF - SECTOR_MARKS_OFF;
+  }
+  if (off == SECTOR_ID_OFF) {
+    uint8_t addr[7] = {MFM_ADDR_MARK, e->cylinder, e->side, s + 1, 0x02};
+    uint16_t crc = crc16_mfm(addr, 5);
+    addr[5] = crc >> 8;
+    addr[6] = crc & 0xFF;
+    mfm_encode_bytes(&e->enc, addr, sizeof(addr));
+    return sizeof(addr);
+  }
+  if (off < SECTOR_DATA_SYNC_OFF) return drive_emu_gap(e, block + SECTOR_DATA_SYNC_OFF);
+  if (off < SECTOR_DATA_MARKS_OFF) return drive_emu_preamble(e, block + SECTOR_DATA_MARKS_OFF);
+  if (off == SECTOR_MARK_OFF) {
+    uint8_t mark = MFM_DATA_MARK;
+    e->data_crc = crc16_mfm(&mark, 1);
+    mfm_encode_bytes(&e->enc, &mark, 1);
+    return 1;
+  }
+  if (off < SECTOR_CRC_OFF) {
+    uint16_t n = SECTOR_CRC_OFF - off;
+    if (n > DRIVE_EMU_PIECE_BYTES) n = DRIVE_EMU_PIECE_BYTES;
+    const uint8_t *d = e->sector_data + (off - SECTOR_DATA_OFF);
+    e->data_crc = crc16(d, n, e->data_crc);
+    mfm_encode_bytes(&e->enc, d, n);
+    return n;
+  }
+  if (off == SECTOR_CRC_OFF) {
+    uint8_t crc[2] = {e->data_crc >> 8, e->data_crc & 0xFF};
+    mfm_encode_bytes(&e->enc, crc, 2);
+    return 2;
+  }
+  return drive_emu_gap(e, block + DRIVE_EMU_SECTOR_BYTES);
+}
+
+static void drive_emu_produce(drive_emu_t *e) {
+  uint8_t buf[DRIVE_EMU_PIECE_MAX];
+  e->enc.buf = buf;
+  e->enc.size = sizeof(buf);
+  e->enc.pos = 0;
+
+  if (e->resync && drive_emu_boundary(e->pos)) e->resync = false;
+  if (e->pos == 0) {
+    e->index_seq = e->head;
+    e->index_pending = true;
+  }
+
+  uint16_t n;
+  if (e->pos < DRIVE_EMU_LEAD_GAP) {
+    n = drive_emu_gap(e, DRIVE_EMU_LEAD_GAP);
+  } else if (e->pos >= DRIVE_EMU_SECTORS_END) {
+    n = drive_emu_gap(e, MFM_TRACK_BYTES);
+  } else {
+    uint16_t off = (e->pos - DRIVE_EMU_LEAD_GAP) % DRIVE_EMU_SECTOR_BYTES;
+    uint8_t s = (e->pos - DRIVE_EMU_LEAD_GAP) / DRIVE_EMU_SECTOR_BYTES;
+    if (e->resync) {
+      n = drive_emu_gap(e, e->pos - off + DRIVE_EMU_SECTOR_BYTES);
+    } else {
+      n = drive_emu_sector_piece(e, s, off);
+    }
+  }
+
+  for (size_t i = 0; i < e->enc.pos; i++) {
+    e->ring[(e->head + i) % DRIVE_EMU_RING] = buf[i];
+  }
+  e->head += e->enc.pos;
+  e->stats.encoded += e->enc.pos;
+  e->enc.buf = NULL;
+  e->enc.size = 0;
+
+  e->pos += n;
+  if (e->pos >= MFM_TRACK_BYTES) e->pos = 0;
+}
+
+static void drive_emu_feed(drive_emu_t *e) {
+  if (!e->motor_on) return;
+
+  while (e->tail != e->head && !pio_sm_is_tx_fifo_full(e->out.pio, e->out.sm)) {
+    if (e->index_pending && e->tail == e->index_seq) {
+      e->index_pending = false;
+      e->index_active = true;
+      e->index_counts = 0;
+      e->angle = 0;
+      e->stats.revolutions++;
+    }
+
+    uint8_t v = e->ring[e->tail % DRIVE_EMU_RING];
+    e->tail++;
+    pio_sm_put_blocking(e->out.pio, e->out.sm, v);
+
+    uint32_t counts = v + MFM_PIO_OVERHEAD;
+    e->angle += counts;
+    if (e->index_active) {
+      e->index_counts += counts;
+      if (e->index_counts >= DRIVE_EMU_INDEX_COUNTS) e->index_active = false;
+    }
+  }
+}
+
+static void drive_emu_store(drive_emu_t *e) {
+  sector_t *s = &e->captured;
+  if (!s->valid || s->track != e->cylinder || s->side != e->side ||
+      s->sector_n < 1 || s->sector_n > SECTORS_PER_TRACK || e->write_protected ||
+      !e->image.write || !e->image.write(e->image.ctx, s->track, s->side, s->sector_n, s->data)) {
+    e->stats.write_errors++;
+    return;
+  }
+  e->stats.sectors_written++;
+}
+
+static void drive_emu_capture_start(drive_emu_t *e) {
+  pio_sm_set_enabled(e->capture.pio, e->capture.sm, false);
+  pio_sm_clear_fifos(e->capture.pio, e->capture.sm);
+  pio_sm_restart(e->capture.pio, e->capture.sm);
+  e->capture.half = 0;
+  pio_sm_exec(e->capture.pio, e->capture.sm, pio_encode_set(pio_x, 0));
+  pio_sm_set_enabled(e->capture.pio, e->capture.sm, true);
+
+  mfm_init(&e->mfm);
+  mfm_reset(&e->mfm);
+  e->capture_primed = false;
+
+  uint16_t pos = drive_emu_angle_byte(e);
+  if (pos >= DRIVE_EMU_LEAD_GAP && pos < DRIVE_EMU_SECTORS_END) {
+    e->mfm.pending_track = e->cylinder;
+    e->mfm.pending_side = e->side;
+    e->mfm.pending_sector = (pos - DRIVE_EMU_LEAD_GAP) / DRIVE_EMU_SECTOR_BYTES + 1;
+    e->mfm.pending_size_code = 2;
+    e->mfm.have_pending_addr = true;
+  }
+}
+
+static void drive_emu_capture_drain(drive_emu_t *e) {
+  while (e->capture.half || !pio_sm_is_rx_fifo_empty(e->capture.pio, e->capture.sm)) {
+    uint16_t value;
+    if (e->capture.half) {
+      value = e->capture.half;
+      e->capture.half = 0;
+    } else {
+      uint32_t pv = pio_sm_get_blocking(e->capture.pio, e->capture.sm);
+      e->capture.half = pv >> 16;
+      value = pv & 0xffff;
+    }
+
+    uint16_t cnt = value >> 1;
+    if (!e->capture_primed) {
+      e->capture_prev = cnt;
+      e->capture_primed = true;
+      continue;
+    }
+    int delta = e->capture_prev - cnt;
+    if (delta < 0) delta += 0x8000;
+    e->capture_prev = cnt;
+
+    if (mfm_feed(&e->mfm, delta, &e->captured)) {
+      drive_emu_store(e);
+    }
+  }
+}
+
+static void drive_emu_capture_stop(drive_emu_t *e) {
+  drive_emu_capture_drain(e);
+  pio_sm_set_enabled(e->capture.pio, e->capture.sm, false);
+  drive_emu_resync(e);
+}
+
+static void drive_emu_step(drive_emu_t *e, bool inward) {
+  if (inward && e->cylinder < FLOPPY_TRACKS - 1) {
+    e->cylinder++;
+  } else if (!inward && e->cylinder > 0) {
+    e->cylinder--;
+  }
+  e->disk_changed = false;
+  e->stats.steps++;
+  drive_emu_resync(e);
+}
+
+static void drive_emu_outputs(drive_emu_t *e) {
+  bool sel = e->selected;
+  gpio_put_oc(e->pins.index, !(sel && e->motor_on && e->index_active));
+  gpio_put_oc(e->pins.track0, !(sel && e->cylinder == 0));
+  gpio_put_oc(e->pins.write_protect, !(sel && e->write_protected));
+  gpio_put_oc(e->pins.disk_change, !(sel && e->disk_changed));
+}
+
+void drive_emu_init(drive_emu_t *e) {
+  uint inputs[] = {e->pins.step, e->pins.direction, e->pins.side_select,
+                   e->pins.write_gate, e->pins.write_data, e->pins.drive_select,
+                   e->pins.motor_enable};
+  for (int i = 0; i < 7; i++) {
+    gpio_init(inputs[i]);
+    gpio_set_dir(inputs[i], GPIO_IN);
+    gpio_pull_up(inputs[i]);
+  }
+  gpio_set_irq_enabled(e->pins.step, GPIO_IRQ_EDGE_FALL, true);
+
+  uint outputs[] = {e->pins.index, e->pins.track0, e->pins.write_protect,
+                    e->pins.disk_change};
+  for (int i = 0; i < 4; i++) {
+    gpio_init(outputs[i]);
+    gpio_put(outputs[i], 0);
+    gpio_set_dir(outputs[i], GPIO_IN);
+  }
+
+  e->out.pio = pio0;
+  e->out.offset = pio_add_program(e->out.pio, &flux_write_program);
+  e->out.sm = pio_claim_unused_sm(e->out.pio, true);
+  e->out.half = 0;
+  flux_write_program_init(e->out.pio, e->out.sm, e->out.offset, e->pins.read_data);
+  pio_sm_set_consecutive_pindirs(e->out.pio, e->out.sm, e->pins.read_data, 1, false);
+  pio_sm_set_enabled(e->out.pio, e->out.sm, true);
+
+  e->capture.pio = pio1;
+  e->capture.offset = pio_add_program(e->capture.pio, &flux_read_program);
+  e->capture.sm = pio_claim_unused_sm(e->capture.pio, true);
+  e->capture.half = 0;
+  flux_read_program_init(e->capture.pio, e->capture.sm, e->capture.offset,
+                         e->pins.write_data, e->pins.write_gate);
+  pio_sm_set_enabled(e->capture.pio, e->capture.sm, false);
+
+  e->cylinder = 0;
+  e->side = 0;
+  e->selected = false;
+  e->motor_on = false;
+  e->writing = false;
+  e->disk_changed = true;
+  gpio_acknowledge_irq(e->pins.step, GPIO_IRQ_EDGE_FALL);
+  e->head = e->tail = 0;
+  e->index_pending = false;
+  e->index_active = false;
+  e->angle = 0;
+  e->pos = 0;
+  e->resync = false;
+  e->sector_ok = false;
+  mfm_encode_init(&e->enc, NULL, 0);
+  memset(&e->stats, 0, sizeof(e->stats));
+}
+
+void drive_emu_change_disk(drive_emu_t *e, drive_emu_image_t image, bool write_protected) {
+  e->image = image;
+  e->write_protected = write_protected;
+  e->disk_changed = true;
+  drive_emu_resync(e);
+}
+
+void drive_emu_poll(drive_emu_t *e) {
+  bool selected = !gpio_get(e->pins.drive_select);
+  if (selected != e->selected) {
+    e->selected = selected;
+    pio_sm_set_consecutive_pindirs(e->out.pio, e->out.sm, e->pins.read_data, 1, selected);
+  }
+
+  bool motor = !gpio_get(e->pins.motor_enable);
+  if (motor != e->motor_on) {
+    e->motor_on = motor;
+    if (motor) drive_emu_resync(e);
+  }
+
+  if (gpio_get_irq_event_mask(e->pins.step) & GPIO_IRQ_EDGE_FALL) {
+    gpio_acknowledge_irq(e->pins.step, GPIO_IRQ_EDGE_FALL);
+    if (selected && !e->writing) drive_emu_step(e, !gpio_get(e->pins.direction));
+  }
+
+  uint8_t side = gpio_get(e->pins.side_select) ? 0 : 1;
+  if (side != e->side) {
+    e->side = side;
+    drive_emu_resync(e);
+  }
+
+  bool writing = selected && !gpio_get(e->pins.write_gate);
+  if (writing && !e->writing) {
+    drive_emu_capture_start(e);
+  } else if (!writing && e->writing) {
+    drive_emu_capture_stop(e);
+  }
+  e->writing = writing;
+  if (writing) drive_emu_capture_drain(e);
+
+  drive_emu_feed(e);
+  for (int i = 0; i < DRIVE_EMU_POLL_PIECES; i++) {
+    if (e->head - e->tail > DRIVE_EMU_RING - DRIVE_EMU_PIECE_MAX) break;
+    drive_emu_produce(e);
+    drive_emu_feed(e);
+  }
+
+  drive_emu_outputs(e);
+}
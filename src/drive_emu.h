@@ -0,0 +1,95 @@
+#ifndef DRIVE_EMU_H
+#define DRIVE_EMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "floppy.h"
+#include "mfm_decode.h"
+#include "mfm_encode.h"
+
+#define DRIVE_EMU_RING 2048
+#define DRIVE_EMU_PIECE_BYTES 4
+#define DRIVE_EMU_PIECE_MAX 64
+#define DRIVE_EMU_POLL_PIECES 4
+#define DRIVE_EMU_LEAD_GAP 80
+#define DRIVE_EMU_SECTOR_BYTES 628
+#define DRIVE_EMU_SECTORS_END (DRIVE_EMU_LEAD_GAP + SECTORS_PER_TRACK * DRIVE_EMU_SECTOR_BYTES)
+#define DRIVE_EMU_BYTE_COUNTS 384
+#define DRIVE_EMU_INDEX_COUNTS 48000
+
+typedef struct {
+  uint8_t step;
+  uint8_t direction;
+  uint8_t side_select;
+  uint8_t write_gate;
+  uint8_t write_data;
+  uint8_t drive_select;
+  uint8_t motor_enable;
+  uint8_t read_data;
+  uint8_t index;
+  uint8_t track0;
+  uint8_t write_protect;
+  uint8_t disk_change;
+} drive_emu_pins_t;
+
+typedef struct {
+  bool (*read)(void *ctx, uint8_t track, uint8_t side, uint8_t sector_n, uint8_t *data);
+  bool (*write)(void *ctx, uint8_t track, uint8_t side, uint8_t sector_n, const uint8_t *data);
+  void *ctx;
+} drive_emu_image_t;
+
+typedef struct {
+  uint32_t revolutions;
+  uint32_t steps;
+  uint32_t resyncs;
+  uint32_t sectors_streamed;
+  uint32_t sectors_missing;
+  uint32_t sectors_written;
+  uint32_t write_errors;
+  uint32_t encoded;
+} drive_emu_stats_t;
+
+typedef struct {
+  drive_emu_pins_t pins;
+  drive_emu_image_t image;
+  bool write_protected;
+
+  floppy_pio_t out;
+  floppy_pio_t capture;
+
+  uint8_t cylinder;
+  uint8_t side;
+  bool selected;
+  bool motor_on;
+  bool writing;
+  bool disk_changed;
+
+  uint8_t ring[DRIVE_EMU_RING];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t index_seq;
+  bool index_pending;
+  bool index_active;
+  uint32_t index_counts;
+  uint32_t angle;
+
+  mfm_encode_t enc;
+  uint16_t pos;
+  bool resync;
+  bool sector_ok;
+  uint16_t data_crc;
+  uint8_t sector_data[SECTOR_SIZE];
+
+  mfm_t mfm;
+  sector_t captured;
+  uint16_t capture_prev;
+  bool capture_primed;
+
+  drive_emu_stats_t stats;
+} drive_emu_t;
+
+void drive_emu_init(drive_emu_t *e);
+void drive_emu_poll(drive_emu_t *e);
+void drive_emu_change_disk(drive_emu_t *e, drive_emu_image_t image, bool write_protected);
+
+#endif
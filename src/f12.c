@@ -1,5 +1,7 @@
 #include "f12.h"
+#include "crc.h"
 #include <string.h>
+#include <stdlib.h>
 
 static f12_err_t f12_set_error(f12_t *fs, f12_err_t err) {
   if (fs) fs->last_error = err;
@@ -20,6 +22,7 @@ static f12_err_t f12_check_disk(f12_t *fs) {
       fs->files[i].mode = F12_MODE_CLOSED;
     }
     fs->fat.batch_in_use = false;
+    fs->archive.pending_count = 0;
 
     fs->mounted = false;
     return f12_set_error(fs, F12_ERR_DISK_CHANGED);
@@ -39,6 +42,254 @@ static f12_err_t f12_check_writable(f12_t *fs) {
   return F12_OK;
 }
 
+static void f12_cache_store(f12_t *fs, const sector_t *sector, bool offer) {
+  uint32_t key = lru_key(sector->track, sector->side, sector->sector_n);
+  if (offer) {
+    if (!lru_offer(fs->cache, key, sector->data)) return;
+  } else {
+    lru_set(fs->cache, key, sector->data);
+  }
+  uint16_t lba = (sector->track * fs->fat.bpb.num_heads + sector->side)
+                 * fs->fat.bpb.sectors_per_track + (sector->sector_n - 1);
+  if (lba < fs->fat.root_dir_start_sector + fs->fat.root_dir_sectors) {
+    lru_pin(fs->cache, key);
+  }
+}
+
+static void f12_sink(void *ctx, const sector_t *sector) {
+  f12_t *fs = (f12_t *)ctx;
+  if (fs->cache) f12_cache_store(fs, sector, true);
+}
+
+static bool f12_archive_covers(f12_t *fs, uint8_t track, uint8_t side) {
+  return fs->archive.level && !fs->archive.stale &&
+         track * 2 + side < fs->archive.first_cylinder * 2;
+}
+
+static uint16_t f12_track_crc(const uint8_t *const data[]) {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) crc = crc16(data[i], SECTOR_SIZE, crc);
+  return crc;
+}
+
+static void f12_parity_locate(f12_t *fs, uint16_t slot, sector_t *sector) {
+  uint16_t lba = fs->archive.first_cylinder * 2 * SECTORS_PER_TRACK + slot;
+  sector->track = lba / (2 * SECTORS_PER_TRACK);
+  sector->side = (lba / SECTORS_PER_TRACK) % 2;
+  sector->sector_n = lba % SECTORS_PER_TRACK + 1;
+  sector->size_code = 2;
+}
+
+static f12_parity_entry_t *f12_pending_find(f12_t *fs, uint16_t slot) {
+  for (int i = 0; i < fs->archive.pending_count; i++) {
+    if (fs->archive.pending[i].slot == slot) return &fs->archive.pending[i];
+  }
+  return NULL;
+}
+
+static bool f12_store_track(f12_t *fs, track_t *track) {
+  if (!fs->io.write(fs->io.ctx, track)) {
+    return false;
+  }
+
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+    if (track->sectors[i].valid) {
+      uint32_t key = lru_key(track->track, track->side, track->sectors[i].sector_n);
+      lru_set(fs->cache, key, track->sectors[i].data);
+    }
+  }
+
+  return true;
+}
+
+static void f12_header_locate(sector_t *sector) {
+  *sector = (sector_t){
+    .track = FLOPPY_TRACKS - 1, .side = 1, .sector_n = SECTORS_PER_TRACK, .size_code = 2,
+  };
+}
+
+static bool f12_write_header(f12_t *fs, uint8_t level) {
+  static track_t track;
+  memset(&track, 0, sizeof(track));
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+    track.sectors[i] = (sector_t){
+      .track = FLOPPY_TRACKS - 1, .side = 1, .sector_n = i + 1, .size_code = 2,
+    };
+  }
+  track.track = FLOPPY_TRACKS - 1;
+  track.side = 1;
+
+  sector_t *h = &track.sectors[SECTORS_PER_TRACK - 1];
+  size_t magic_len = sizeof(F12_PARITY_MAGIC) - 1;
+  memcpy(h->data, F12_PARITY_MAGIC, magic_len);
+  h->data[F12_PARITY_LEVEL_OFFSET] = level;
+  h->data[F12_PARITY_FIRST_OFFSET] = fs->archive.first_cylinder;
+  h->data[F12_PARITY_DIRTY_OFFSET] = fs->archive.dirty;
+  for (int t = 0; t < fs->archive.first_cylinder * 2; t++) {
+    h->data[F12_PARITY_CRC_OFFSET + t * 2] = fs->archive.track_crc[t] >> 8;
+    h->data[F12_PARITY_CRC_OFFSET + t * 2 + 1] = fs->archive.track_crc[t] & 0xFF;
+  }
+  h->valid = true;
+  return f12_store_track(fs, &track);
+}
+
+static bool f12_mark_dirty(f12_t *fs) {
+  if (fs->archive.dirty) return true;
+  fs->archive.dirty = true;
+  if (!f12_write_header(fs, fs->archive.level)) {
+    fs->archive.dirty = false;
+    return false;
+  }
+  return true;
+}
+
+static f12_err_t f12_write_pending(f12_t *fs) {
+  static track_t track;
+
+  while (fs->archive.pending_count > 0) {
+    sector_t loc;
+    f12_parity_locate(fs, fs->archive.pending[0].slot, &loc);
+    memset(&track, 0, sizeof(track));
+    track.track = loc.track;
+    track.side = loc.side;
+
+    uint8_t keep = 0;
+    for (uint8_t i = 0; i < fs->archive.pending_count; i++) {
+      f12_parity_entry_t *e = &fs->archive.pending[i];
+      sector_t at;
+      f12_parity_locate(fs, e->slot, &at);
+      if (at.track == loc.track && at.side == loc.side) {
+        sector_t *s = &track.sectors[at.sector_n - 1];
+        *s = at;
+        memcpy(s->data, e->data, SECTOR_SIZE);
+        s->valid = true;
+      } else {
+        if (keep != i) fs->archive.pending[keep] = *e;
+        keep++;
+      }
+    }
+    fs->archive.pending_count = keep;
+
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+      track.sectors[i].track = loc.track;
+      track.sectors[i].side = loc.side;
+      track.sectors[i].sector_n = i + 1;
+    }
+
+    if (!f12_store_track(fs, &track)) {
+      return F12_ERR_IO;
+    }
+    fs->archive.stats.parity_writes++;
+  }
+
+  if (fs->archive.dirty && !fs->archive.stale) {
+    fs->archive.dirty = false;
+    if (!f12_write_header(fs, fs->archive.level)) {
+      fs->archive.dirty = true;
+      return F12_ERR_IO;
+    }
+  }
+
+  return F12_OK;
+}
+
+static bool f12_pending_put(f12_t *fs, uint16_t slot, const uint8_t *data) {
+  f12_parity_entry_t *e = f12_pending_find(fs, slot);
+  if (!e) {
+    if (fs->archive.pending_count == F12_PARITY_PENDING && f12_write_pending(fs) != F12_OK) {
+      return false;
+    }
+    e = &fs->archive.pending[fs->archive.pending_count++];
+    e->slot = slot;
+  }
+  memcpy(e->data, data, SECTOR_SIZE);
+  return true;
+}
+
+static bool f12_archive_fetch(f12_t *fs, sector_t *sector) {
+  uint8_t *cached = lru_get(fs->cache, lru_key(sector->track, sector->side, sector->sector_n));
+  if (cached) {
+    memcpy(sector->data, cached, SECTOR_SIZE);
+    sector->valid = true;
+    return true;
+  }
+
+  bool (*read)(void *, sector_t *) = fs->io.read_quick ? fs->io.read_quick : fs->io.read;
+  if (!read(fs->io.ctx, sector) || !sector->valid) {
+    return false;
+  }
+  f12_cache_store(fs, sector, false);
+  return true;
+}
+
+static bool f12_archive_rebuild(f12_t *fs, sector_t *sector) {
+  static track_t work;
+  static uint8_t shards[PARITY_MAX_SHARDS][SECTOR_SIZE];
+  uint8_t level = fs->archive.level;
+  uint16_t t = sector->track * 2 + sector->side;
+  uint8_t *data[SECTORS_PER_TRACK];
+  bool present[SECTORS_PER_TRACK];
+  int missing = 0;
+
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+    sector_t *s = &work.sectors[i];
+    s->track = sector->track;
+    s->side = sector->side;
+    s->sector_n = i + 1;
+    s->size_code = 2;
+    data[i] = s->data;
+    present[i] = i != sector->sector_n - 1 && f12_archive_fetch(fs, s);
+    if (!present[i] && ++missing > level) return false;
+  }
+
+  const uint8_t *pq[PARITY_MAX_SHARDS] = { NULL, NULL };
+  int available = 0;
+  for (int j = 0; j < level; j++) {
+    uint16_t slot = t * level + j;
+    f12_parity_entry_t *e = f12_pending_find(fs, slot);
+    if (e) {
+      memcpy(shards[j], e->data, SECTOR_SIZE);
+    } else {
+      sector_t ps;
+      f12_parity_locate(fs, slot, &ps);
+      if (!f12_archive_fetch(fs, &ps)) continue;
+      memcpy(shards[j], ps.data, SECTOR_SIZE);
+    }
+    pq[j] = shards[j];
+    available++;
+  }
+  if (missing > available) return false;
+
+  if (!parity_rebuild(data, SECTORS_PER_TRACK, SECTOR_SIZE, present, pq[0], pq[1])) {
+    return false;
+  }
+  if (f12_track_crc((const uint8_t *const *)data) != fs->archive.track_crc[t]) {
+    return false;
+  }
+  memcpy(sector->data, data[sector->sector_n - 1], SECTOR_SIZE);
+  sector->valid = true;
+  return true;
+}
+
+static bool f12_archive_read(f12_t *fs, sector_t *sector) {
+  bool (*read)(void *, sector_t *) = fs->io.read_quick ? fs->io.read_quick : fs->io.read;
+  if (read(fs->io.ctx, sector) && sector->valid) {
+    return true;
+  }
+  fs->archive.stats.quick_fails++;
+
+  if (f12_archive_rebuild(fs, sector)) {
+    fs->archive.stats.rebuilt++;
+    return true;
+  }
+  fs->archive.stats.rebuild_fails++;
+
+  if (!fs->io.read_quick) {
+    return false;
+  }
+  return fs->io.read(fs->io.ctx, sector);
+}
+
 static bool f12_cached_read(void *ctx, sector_t *sector) {
   f12_t *fs = (f12_t *)ctx;
 
@@ -56,21 +307,16 @@ static bool f12_cached_read(void *ctx, sector_t *sector) {
     return true;
   }
 
-  if (fs->io.read_track) {
+  bool archived = f12_archive_covers(fs, sector->track, sector->side);
+
+  if (fs->io.read_track && !archived) {
     static track_t track;
     track.track = sector->track;
     track.side = sector->side;
     fs->io.read_track(fs->io.ctx, &track);
-    uint16_t pin_limit = fs->fat.root_dir_start_sector + fs->fat.root_dir_sectors;
-    uint16_t track_lba_base = (track.track * fs->fat.bpb.num_heads + track.side)
-                              * fs->fat.bpb.sectors_per_track;
     for (int i = 0; i < SECTORS_PER_TRACK; i++) {
       if (track.sectors[i].valid) {
-        uint32_t k = lru_key(track.track, track.side, i + 1);
-        lru_set(fs->cache, k, track.sectors[i].data);
-        if (track_lba_base + i < pin_limit) {
-          lru_pin(fs->cache, k);
-        }
+        f12_cache_store(fs, &track.sectors[i], false);
       }
     }
     cached = lru_get(fs->cache, key);
@@ -81,19 +327,50 @@ static bool f12_cached_read(void *ctx, sector_t *sector) {
     }
   }
 
-  if (!fs->io.read(fs->io.ctx, sector)) {
+  if (!(archived ? f12_archive_read(fs, sector) : fs->io.read(fs->io.ctx, sector))) {
     return false;
   }
 
   if (sector->valid) {
-    lru_set(fs->cache, key, sector->data);
-    uint16_t lba = (sector->track * fs->fat.bpb.num_heads + sector->side)
-                   * fs->fat.bpb.sectors_per_track + (sector->sector_n - 1);
-    if (lba < fs->fat.root_dir_start_sector + fs->fat.root_dir_sectors) {
-      lru_pin(fs->cache, key);
-    }
+    f12_cache_store(fs, sector, false);
+  }
+
+  return true;
+}
+
+static bool f12_archive_fill(f12_t *fs, track_t *track) {
+  if (!f12_archive_covers(fs, track->track, track->side)) return true;
+
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+    sector_t *s = &track->sectors[i];
+    if (s->valid) continue;
+    s->track = track->track;
+    s->side = track->side;
+    s->sector_n = i + 1;
+    s->size_code = 2;
+    if (!f12_cached_read(fs, s) || !s->valid) return false;
+  }
+  return true;
+}
+
+static bool f12_archive_note_write(f12_t *fs, track_t *track) {
+  static uint8_t shards[PARITY_MAX_SHARDS][SECTOR_SIZE];
+  if (!f12_archive_covers(fs, track->track, track->side)) return true;
+
+  const uint8_t *data[SECTORS_PER_TRACK];
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+    if (!track->sectors[i].valid) return false;
+    data[i] = track->sectors[i].data;
   }
 
+  uint8_t level = fs->archive.level;
+  parity_encode(data, SECTORS_PER_TRACK, SECTOR_SIZE, shards[0], level > 1 ? shards[1] : NULL);
+
+  uint16_t t = track->track * 2 + track->side;
+  fs->archive.track_crc[t] = f12_track_crc(data);
+  for (int j = 0; j < level; j++) {
+    if (!f12_pending_put(fs, t * level + j, shards[j])) return false;
+  }
   return true;
 }
 
@@ -106,18 +383,19 @@ static bool f12_cached_write(void *ctx, track_t *track) {
     }
   }
 
-  if (!fs->io.write(fs->io.ctx, track)) {
+  if (!f12_archive_fill(fs, track)) {
     return false;
   }
 
-  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
-    if (track->sectors[i].valid) {
-      uint32_t key = lru_key(track->track, track->side, track->sectors[i].sector_n);
-      lru_set(fs->cache, key, track->sectors[i].data);
-    }
+  if (f12_archive_covers(fs, track->track, track->side) && !f12_mark_dirty(fs)) {
+    return false;
   }
 
-  return true;
+  if (!f12_store_track(fs, track)) {
+    return false;
+  }
+
+  return f12_archive_note_write(fs, track);
 }
 
 static f12_file_t *f12_alloc_file(f12_t *fs) {
@@ -162,12 +440,52 @@ static void format_name_83(const fat12_dirent_t *entry, char *out) {
   out[j] = '\0';
 }
 
+uint8_t f12_archive_cylinders(uint8_t level) {
+  if (level == 0 || level > PARITY_MAX_SHARDS) return 0;
+  uint8_t k = 1;
+  while (level * 2 * (FLOPPY_TRACKS - k) + 1 > k * 2 * SECTORS_PER_TRACK) k++;
+  return k;
+}
+
+static f12_err_t f12_archive_load(f12_t *fs) {
+  uint16_t last;
+  if (fat12_get_entry(&fs->fat, fs->fat.total_clusters + 1, &last) != FAT12_OK) return F12_ERR_IO;
+  if (last != 0xFF7 || fs->fat.bpb.total_sectors != FLOPPY_TRACKS * 2 * SECTORS_PER_TRACK) {
+    return F12_OK;
+  }
+
+  sector_t header;
+  f12_header_locate(&header);
+  if (!f12_cached_read(fs, &header) || !header.valid) return F12_OK;
+
+  size_t magic_len = sizeof(F12_PARITY_MAGIC) - 1;
+  if (memcmp(header.data, F12_PARITY_MAGIC, magic_len) != 0) return F12_OK;
+
+  uint8_t level = header.data[F12_PARITY_LEVEL_OFFSET];
+  uint8_t cyls = f12_archive_cylinders(level);
+  if (!cyls || header.data[F12_PARITY_FIRST_OFFSET] != FLOPPY_TRACKS - cyls) return F12_OK;
+
+  fs->archive.pending = malloc(F12_PARITY_PENDING * sizeof(f12_parity_entry_t));
+  if (!fs->archive.pending) return F12_ERR_IO;
+  fs->archive.pending_count = 0;
+  fs->archive.first_cylinder = FLOPPY_TRACKS - cyls;
+  fs->archive.level = level;
+  fs->archive.dirty = header.data[F12_PARITY_DIRTY_OFFSET] != 0;
+  fs->archive.stale = fs->archive.dirty;
+  for (int t = 0; t < fs->archive.first_cylinder * 2; t++) {
+    fs->archive.track_crc[t] = (header.data[F12_PARITY_CRC_OFFSET + t * 2] << 8) |
+                               header.data[F12_PARITY_CRC_OFFSET + t * 2 + 1];
+  }
+  return F12_OK;
+}
+
 f12_err_t f12_mount(f12_t *fs, f12_io_t io) {
   if (!fs) return F12_ERR_INVALID;
 
   if (fs->cache) {
     lru_free(fs->cache);
   }
+  free(fs->archive.pending);
 
   memset(fs, 0, sizeof(*fs));
   fs->io = io;
@@ -176,6 +494,7 @@ f12_err_t f12_mount(f12_t *fs, f12_io_t io) {
   if (!fs->cache) {
     return f12_set_error(fs, F12_ERR_IO);
   }
+  lru_set_offer_limit(fs->cache, SECTORS_PER_TRACK);
 
   fat12_io_t fat_io = {
     .read = f12_cached_read,
@@ -183,13 +502,26 @@ f12_err_t f12_mount(f12_t *fs, f12_io_t io) {
     .ctx = fs,
   };
 
+  if (fs->io.set_sink)
+    fs->io.set_sink(fs->io.ctx, f12_sink, fs);
+
   fat12_err_t err = fat12_init(&fs->fat, fat_io);
   if (err != FAT12_OK) {
+    if (fs->io.set_sink)
+      fs->io.set_sink(fs->io.ctx, NULL, NULL);
     lru_free(fs->cache);
     fs->cache = NULL;
     return f12_set_error(fs, fat12_to_f12_err(err));
   }
 
+  if (f12_archive_load(fs) != F12_OK) {
+    if (fs->io.set_sink)
+      fs->io.set_sink(fs->io.ctx, NULL, NULL);
+    lru_free(fs->cache);
+    fs->cache = NULL;
+    return f12_set_error(fs, F12_ERR_IO);
+  }
+
   if (fs->io.disk_changed)
     fs->io.disk_changed(fs->io.ctx);
 
@@ -206,6 +538,15 @@ void f12_unmount(f12_t *fs) {
     }
   }
 
+  if (fs->mounted && fs->archive.level) {
+    f12_write_pending(fs);
+  }
+  free(fs->archive.pending);
+  memset(&fs->archive, 0, sizeof(fs->archive));
+
+  if (fs->io.set_sink)
+    fs->io.set_sink(fs->io.ctx, NULL, NULL);
+
   if (fs->cache) {
     lru_free(fs->cache);
     fs->cache = NULL;
@@ -233,13 +574,21 @@ f12_err_t f12_format(f12_t *fs, const char *label, bool full) {
   }
 
   if (fs->mounted) {
+    fat12_alloc_t policy = fs->fat.alloc_policy;
     fs->mounted = false;
-    return f12_mount(fs, fs->io);
+    f12_err_t merr = f12_mount(fs, fs->io);
+    fs->fat.alloc_policy = policy;
+    return merr;
   }
 
   return F12_OK;
 }
 
+void f12_set_alloc_policy(f12_t *fs, fat12_alloc_t policy) {
+  if (!fs) return;
+  fs->fat.alloc_policy = policy;
+}
+
 f12_file_t *f12_open(f12_t *fs, const char *path, const char *mode) {
   if (!fs || !path || !mode) {
     f12_set_error(fs, F12_ERR_INVALID);
@@ -323,6 +672,10 @@ f12_err_t f12_close(f12_file_t *file) {
       file->mode = F12_MODE_CLOSED;
       return f12_set_error(fs, fat12_to_f12_err(ferr));
     }
+    if (f12_write_pending(fs) != F12_OK) {
+      file->mode = F12_MODE_CLOSED;
+      return f12_set_error(fs, F12_ERR_IO);
+    }
   }
 
   file->mode = F12_MODE_CLOSED;
@@ -373,6 +726,17 @@ int f12_write(f12_file_t *file, const void *buf, size_t len) {
   return n;
 }
 
+f12_err_t f12_set_size_hint(f12_file_t *file, uint32_t size) {
+  if (!file || !file->fs) return F12_ERR_INVALID;
+
+  if (file->mode != F12_MODE_WRITE) {
+    return f12_set_error(file->fs, F12_ERR_INVALID);
+  }
+
+  fat12_set_size_hint(&file->writer, size);
+  return F12_OK;
+}
+
 f12_err_t f12_seek(f12_file_t *file, uint32_t offset) {
   if (!file || !file->fs) return F12_ERR_BAD_HANDLE;
 
@@ -447,6 +811,10 @@ f12_err_t f12_delete(f12_t *fs, const char *path) {
     return f12_set_error(fs, fat12_to_f12_err(ferr));
   }
 
+  if (f12_write_pending(fs) != F12_OK) {
+    return f12_set_error(fs, F12_ERR_IO);
+  }
+
   return F12_OK;
 }
 
@@ -526,6 +894,117 @@ f12_err_t f12_list(f12_t *fs, f12_list_cb cb, void *ctx) {
   return F12_OK;
 }
 
+static bool f12_read_track_data(f12_t *fs, uint16_t t, track_t *track) {
+  for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+    sector_t *s = &track->sectors[i];
+    s->track = t / 2;
+    s->side = t % 2;
+    s->sector_n = i + 1;
+    s->size_code = 2;
+    if (!f12_cached_read(fs, s) || !s->valid) return false;
+  }
+  return true;
+}
+
+static f12_err_t f12_archive_build(f12_t *fs, uint8_t level, track_t *data, track_t *out) {
+  uint16_t used = fs->archive.first_cylinder * 2 * level;
+  uint16_t total = (FLOPPY_TRACKS - fs->archive.first_cylinder) * 2 * SECTORS_PER_TRACK;
+
+  for (uint16_t base = 0; base < total; base += SECTORS_PER_TRACK) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+      f12_parity_locate(fs, base + i, &out->sectors[i]);
+      out->sectors[i].valid = true;
+    }
+    out->track = out->sectors[0].track;
+    out->side = out->sectors[0].side;
+
+    for (uint16_t slot = base; slot < base + SECTORS_PER_TRACK && slot < used; slot += level) {
+      if (!f12_read_track_data(fs, slot / level, data)) return F12_ERR_IO;
+      const uint8_t *ptrs[SECTORS_PER_TRACK];
+      for (int i = 0; i < SECTORS_PER_TRACK; i++) ptrs[i] = data->sectors[i].data;
+      fs->archive.track_crc[slot / level] = f12_track_crc(ptrs);
+      sector_t *p = &out->sectors[slot - base];
+      parity_encode(ptrs, SECTORS_PER_TRACK, SECTOR_SIZE, p->data, level > 1 ? p[1].data : NULL);
+    }
+
+    if (!f12_store_track(fs, out)) return F12_ERR_IO;
+    fs->archive.stats.parity_writes++;
+  }
+
+  return F12_OK;
+}
+
+f12_err_t f12_archive_enable(f12_t *fs, uint8_t level) {
+  if (!fs) return F12_ERR_INVALID;
+
+  f12_err_t err = f12_check_writable(fs);
+  if (err != F12_OK) return err;
+
+  const fat12_bpb_t *bpb = &fs->fat.bpb;
+  uint8_t cyls = f12_archive_cylinders(level);
+  bool resync = fs->archive.stale && fs->archive.level == level;
+  if (!cyls || (fs->archive.level && !resync) || bpb->sectors_per_cluster != 1 ||
+      bpb->sectors_per_track != SECTORS_PER_TRACK || bpb->num_heads != 2 ||
+      bpb->total_sectors != FLOPPY_TRACKS * 2 * SECTORS_PER_TRACK) {
+    return f12_set_error(fs, F12_ERR_INVALID);
+  }
+
+  uint8_t first = FLOPPY_TRACKS - cyls;
+  uint16_t cluster = first * 2 * SECTORS_PER_TRACK - fs->fat.data_start_sector + 2;
+  uint16_t count = fs->fat.total_clusters + 2 - cluster;
+  if (!resync) {
+    fat12_err_t ferr = fat12_reserve_clusters(&fs->fat, cluster, count);
+    if (ferr != FAT12_OK) {
+      return f12_set_error(fs, fat12_to_f12_err(ferr));
+    }
+    fs->archive.pending = malloc(F12_PARITY_PENDING * sizeof(f12_parity_entry_t));
+  }
+
+  track_t *data = malloc(sizeof(track_t));
+  track_t *out = malloc(sizeof(track_t));
+  err = F12_ERR_IO;
+  if (!fs->archive.pending || !data || !out) goto done;
+
+  fs->archive.first_cylinder = first;
+  fs->archive.pending_count = 0;
+  err = f12_archive_build(fs, level, data, out);
+  if (err != F12_OK) goto done;
+
+  fs->archive.dirty = false;
+  err = F12_ERR_IO;
+  if (!f12_write_header(fs, level)) goto done;
+  fs->archive.level = level;
+  fs->archive.stale = false;
+  err = F12_OK;
+
+done:
+  free(data);
+  free(out);
+  if (err != F12_OK) {
+    if (!resync) {
+      free(fs->archive.pending);
+      fs->archive.pending = NULL;
+      fs->archive.level = 0;
+      fat12_release_clusters(&fs->fat, cluster, count);
+    }
+    fs->archive.pending_count = 0;
+    return f12_set_error(fs, err);
+  }
+  return F12_OK;
+}
+
+f12_err_t f12_archive_flush(f12_t *fs) {
+  if (!fs) return F12_ERR_INVALID;
+
+  f12_err_t err = f12_check_writable(fs);
+  if (err != F12_OK) return err;
+
+  err = f12_write_pending(fs);
+  if (err != F12_OK) return f12_set_error(fs, err);
+  return F12_OK;
+}
+
 f12_err_t f12_errno(f12_t *fs) {
   if (!fs) return F12_ERR_INVALID;
   return fs->last_error;
@@ -7,9 +7,17 @@
 #include "floppy.h"
 #include "fat12.h"
 #include "lru.h"
+#include "parity.h"
 
 #define F12_MAX_OPEN_FILES 10
 #define F12_CACHE_SIZE 54
+#define F12_PARITY_PENDING 18
+#define F12_PARITY_MAGIC "F12PAR"
+#define F12_PARITY_LEVEL_OFFSET 6
+#define F12_PARITY_FIRST_OFFSET 7
+#define F12_PARITY_DIRTY_OFFSET 8
+#define F12_PARITY_CRC_OFFSET 16
+#define F12_PARITY_MAX_TRACKS 150
 
 typedef enum {
   F12_OK = 0,
@@ -44,10 +52,12 @@ typedef struct {
 
 typedef struct {
   bool (*read)(void *ctx, sector_t *sector);
+  bool (*read_quick)(void *ctx, sector_t *sector);
   bool (*read_track)(void *ctx, track_t *track);
   bool (*write)(void *ctx, track_t *track);
   bool (*disk_changed)(void *ctx);
   bool (*write_protected)(void *ctx);
+  void (*set_sink)(void *ctx, floppy_sink_t sink, void *sink_ctx);
   void *ctx;
 } f12_io_t;
 
@@ -67,6 +77,29 @@ struct f12_file {
   uint32_t position;
 };
 
+typedef struct {
+  uint16_t slot;
+  uint8_t data[SECTOR_SIZE];
+} f12_parity_entry_t;
+
+typedef struct {
+  uint32_t parity_writes;
+  uint32_t quick_fails;
+  uint32_t rebuilt;
+  uint32_t rebuild_fails;
+} f12_archive_stats_t;
+
+typedef struct {
+  uint8_t level;
+  uint8_t first_cylinder;
+  f12_parity_entry_t *pending;
+  uint8_t pending_count;
+  bool dirty;
+  bool stale;
+  uint16_t track_crc[F12_PARITY_MAX_TRACKS];
+  f12_archive_stats_t stats;
+} f12_archive_t;
+
 struct f12 {
   f12_io_t io;
   fat12_t fat;
@@ -75,16 +108,19 @@ struct f12 {
   f12_file_t files[F12_MAX_OPEN_FILES];
   f12_err_t last_error;
   bool mounted;
+  f12_archive_t archive;
 };
 
 f12_err_t f12_mount(f12_t *fs, f12_io_t io);
 void f12_unmount(f12_t *fs);
 f12_err_t f12_format(f12_t *fs, const char *label, bool full);
+void f12_set_alloc_policy(f12_t *fs, fat12_alloc_t policy);
 
 f12_file_t *f12_open(f12_t *fs, const char *path, const char *mode);
 f12_err_t f12_close(f12_file_t *file);
 int f12_read(f12_file_t *file, void *buf, size_t len);
 int f12_write(f12_file_t *file, const void *buf, size_t len);
+f12_err_t f12_set_size_hint(f12_file_t *file, uint32_t size);
 f12_err_t f12_seek(f12_file_t *file, uint32_t offset);
 uint32_t f12_tell(f12_file_t *file);
 
@@ -100,6 +136,10 @@ f12_err_t f12_closedir(f12_dir_t *dir);
 typedef void (*f12_list_cb)(const f12_stat_t *stat, void *ctx);
 f12_err_t f12_list(f12_t *fs, f12_list_cb cb, void *ctx);
 
+f12_err_t f12_archive_enable(f12_t *fs, uint8_t level);
+f12_err_t f12_archive_flush(f12_t *fs);
+uint8_t f12_archive_cylinders(uint8_t level);
+
 f12_err_t f12_errno(f12_t *fs);
 const char *f12_strerror(f12_err_t err);
 
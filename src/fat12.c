@@ -587,6 +587,48 @@ static fat12_err_t fat12_find_free_cluster_from(fat12_write_batch_t *batch,
   return FAT12_ERR_FULL;
 }
 
+static uint16_t fat12_large_zone(fat12_t *fat) {
+  uint32_t lba = (uint32_t)FAT12_LARGE_ZONE_CYLINDER *
+                 fat->bpb.sectors_per_track * fat->bpb.num_heads;
+  if (lba <= fat->data_start_sector || fat->bpb.sectors_per_cluster == 0) return 2;
+  uint32_t cluster = (lba - fat->data_start_sector) / fat->bpb.sectors_per_cluster + 2;
+  if (cluster >= (uint32_t)fat->total_clusters + 2) return 2;
+  return cluster;
+}
+
+static void fat12_note_freed(fat12_t *fat, uint16_t start) {
+  if (start < 2) return;
+  if (start < fat->next_free_hint) {
+    fat->next_free_hint = start;
+  }
+  if (start >= fat12_large_zone(fat) && start < fat->large_free_hint) {
+    fat->large_free_hint = start;
+  }
+}
+
+static fat12_err_t fat12_alloc_cluster(fat12_writer_t *writer, uint16_t *out) {
+  fat12_t *fat = writer->fat;
+  bool large = fat->alloc_policy == FAT12_ALLOC_LOCALITY &&
+               (writer->size_hint > FAT12_SMALL_FILE_MAX ||
+                (!writer->rewrite && writer->bytes_written >= FAT12_SMALL_FILE_MAX));
+
+  if (large) {
+    uint16_t zone = fat12_large_zone(fat);
+    uint16_t start = fat->large_free_hint > zone ? fat->large_free_hint : zone;
+    fat12_err_t err = fat12_find_free_cluster_from(writer->batch, start, out);
+    if (err == FAT12_OK) {
+      fat->large_free_hint = *out + 1;
+      return FAT12_OK;
+    }
+    if (err != FAT12_ERR_FULL) return err;
+  }
+
+  fat12_err_t err = fat12_find_free_cluster_from(writer->batch, fat->next_free_hint, out);
+  if (err != FAT12_OK) return err;
+  fat->next_free_hint = *out + 1;
+  return FAT12_OK;
+}
+
 static fat12_err_t fat12_write_cluster(fat12_write_batch_t *batch,
                                        uint16_t cluster, const uint8_t *buf) {
   fat12_t *fat = batch->fat;
@@ -727,9 +769,8 @@ fat12_err_t fat12_open_write(fat12_t *fat, const char *filename, fat12_writer_t
       fat12_err_t err = fat12_free_chain(fat, writer->batch, old_start);
       if (err != FAT12_OK) return err;
 
-      if (old_start >= 2 && old_start < fat->next_free_hint) {
-        fat->next_free_hint = old_start;
-      }
+      fat12_note_freed(fat, old_start);
+      writer->rewrite = old_start < fat12_large_zone(fat);
 
       writer->dirent.start_cluster = 0;
       writer->dirent.size = 0;
@@ -740,6 +781,10 @@ fat12_err_t fat12_open_write(fat12_t *fat, const char *filename, fat12_writer_t
   return FAT12_ERR_FULL;
 }
 
+void fat12_set_size_hint(fat12_writer_t *writer, uint32_t size) {
+  writer->size_hint = size;
+}
+
 int fat12_write(fat12_writer_t *writer, const uint8_t *buf, uint16_t len) {
   fat12_t *fat = writer->fat;
   uint16_t cluster_size = fat->bpb.sectors_per_cluster * SECTOR_SIZE;
@@ -752,7 +797,7 @@ int fat12_write(fat12_writer_t *writer, const uint8_t *buf, uint16_t len) {
   while (len > 0) {
     if (writer->current_cluster == 0 || writer->cluster_offset >= cluster_size) {
       uint16_t new_cluster;
-      fat12_err_t err = fat12_find_free_cluster_from(writer->batch, fat->next_free_hint, &new_cluster);
+      fat12_err_t err = fat12_alloc_cluster(writer, &new_cluster);
       if (err != FAT12_OK) return -err;
 
       err = fat12_set_entry(writer->batch, new_cluster, 0xFFF);
@@ -770,7 +815,6 @@ int fat12_write(fat12_writer_t *writer, const uint8_t *buf, uint16_t len) {
       writer->prev_cluster = writer->current_cluster;
       writer->current_cluster = new_cluster;
       writer->cluster_offset = 0;
-      fat->next_free_hint = new_cluster + 1;
     }
 
     uint16_t remaining_in_cluster = cluster_size - writer->cluster_offset;
@@ -854,9 +898,7 @@ fat12_err_t fat12_delete(fat12_t *fat, const char *filename) {
       err = fat12_free_chain(fat, &fat->batch, entry.start_cluster);
       if (err != FAT12_OK) { result = err; goto done; }
 
-      if (entry.start_cluster >= 2 && entry.start_cluster < fat->next_free_hint) {
-        fat->next_free_hint = entry.start_cluster;
-      }
+      fat12_note_freed(fat, entry.start_cluster);
 
       entry.name[0] = FAT12_DIRENT_FREE;
       err = fat12_write_root_entry(&fat->batch, i, &entry);
@@ -873,6 +915,64 @@ done:
   return result;
 }
 
+fat12_err_t fat12_reserve_clusters(fat12_t *fat, uint16_t first, uint16_t count) {
+  if (fat->batch_in_use) return FAT12_ERR_INVALID;
+  if (first < 2 || first + count > fat->total_clusters + 2) return FAT12_ERR_INVALID;
+
+  fat->batch_in_use = true;
+  if (!fat12_write_batch_init(&fat->batch, fat)) {
+    fat->batch_in_use = false;
+    return FAT12_ERR_READ;
+  }
+
+  fat12_err_t result = FAT12_OK;
+  for (uint16_t c = first; c < first + count; c++) {
+    uint16_t entry;
+    result = fat12_get_entry_batched(&fat->batch, c, &entry);
+    if (result != FAT12_OK) goto done;
+    if (!fat12_is_free(entry)) { result = FAT12_ERR_FULL; goto done; }
+  }
+
+  for (uint16_t c = first; c < first + count; c++) {
+    result = fat12_set_entry(&fat->batch, c, 0xFF7);
+    if (result != FAT12_OK) goto done;
+  }
+  result = fat12_write_batch_flush(&fat->batch);
+
+done:
+  fat12_write_batch_release(&fat->batch);
+  fat->batch_in_use = false;
+  return result;
+}
+
+fat12_err_t fat12_release_clusters(fat12_t *fat, uint16_t first, uint16_t count) {
+  if (fat->batch_in_use) return FAT12_ERR_INVALID;
+  if (first < 2 || first + count > fat->total_clusters + 2) return FAT12_ERR_INVALID;
+
+  fat->batch_in_use = true;
+  if (!fat12_write_batch_init(&fat->batch, fat)) {
+    fat->batch_in_use = false;
+    return FAT12_ERR_READ;
+  }
+
+  fat12_err_t result = FAT12_OK;
+  for (uint16_t c = first; c < first + count; c++) {
+    uint16_t entry;
+    result = fat12_get_entry_batched(&fat->batch, c, &entry);
+    if (result != FAT12_OK) goto done;
+    if (!fat12_is_bad(entry)) continue;
+    result = fat12_set_entry(&fat->batch, c, 0);
+    if (result != FAT12_OK) goto done;
+  }
+  result = fat12_write_batch_flush(&fat->batch);
+  if (result == FAT12_OK) fat12_note_freed(fat, first);
+
+done:
+  fat12_write_batch_release(&fat->batch);
+  fat->batch_in_use = false;
+  return result;
+}
+
 static void fat12_build_boot_sector(uint8_t *boot, const fat12_bpb_t *bpb,
                                     const char *volume_label) {
   memset(boot, 0, SECTOR_SIZE);
@@ -1043,3 +1143,274 @@ fat12_err_t fat12_format(fat12_io_t io, const char *volume_label, bool write_all
 
   return FAT12_OK;
 }
+
+static uint16_t fat12_build_tracks(const fat12_layout_t *lay, uint16_t cluster,
+                                   uint16_t n) {
+  if (n == 0) return 0;
+  uint16_t first = lay->data_start_sector + cluster - 2;
+  uint16_t last = first + n - 1;
+  return last / lay->bpb.sectors_per_track - first / lay->bpb.sectors_per_track + 1;
+}
+
+static fat12_err_t fat12_build_place(const fat12_layout_t *lay,
+                                     fat12_build_file_t *files, uint16_t count,
+                                     bool align) {
+  uint16_t spt = lay->bpb.sectors_per_track;
+  uint16_t end = (lay->bpb.total_sectors - lay->data_start_sector) + 2;
+  uint16_t cursor = 2;
+  uint16_t gap_start[FAT12_BUILD_MAX_GAPS];
+  uint16_t gap_len[FAT12_BUILD_MAX_GAPS];
+  uint8_t gaps = 0;
+
+  bool *placed = (bool *)calloc(count ? count : 1, sizeof(bool));
+  if (!placed) return FAT12_ERR_INVALID;
+
+  for (uint16_t k = 0; k < count; k++) {
+    int best = -1;
+    for (uint16_t i = 0; i < count; i++) {
+      if (placed[i]) continue;
+      if (best < 0 || files[i].size > files[best].size) best = i;
+    }
+    placed[best] = true;
+
+    fat12_build_file_t *f = &files[best];
+    uint32_t n = (f->size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    f->start_cluster = 0;
+    if (n == 0) continue;
+
+    bool done = false;
+    for (uint8_t g = 0; g < gaps && !done; g++) {
+      if (gap_len[g] >= n) {
+        f->start_cluster = gap_start[g];
+        gap_start[g] += n;
+        gap_len[g] -= n;
+        done = true;
+      }
+    }
+    if (done) continue;
+
+    uint16_t at = cursor;
+    if (align && gaps < FAT12_BUILD_MAX_GAPS) {
+      uint16_t lba = lay->data_start_sector + cursor - 2;
+      uint16_t aligned = cursor + (spt - lba % spt) % spt;
+      if (aligned != cursor && aligned + n <= end &&
+          fat12_build_tracks(lay, aligned, n) < fat12_build_tracks(lay, cursor, n)) {
+        gap_start[gaps] = cursor;
+        gap_len[gaps] = aligned - cursor;
+        gaps++;
+        at = aligned;
+      }
+    }
+
+    if (at + n > end) {
+      free(placed);
+      return FAT12_ERR_FULL;
+    }
+    f->start_cluster = at;
+    cursor = at + n;
+  }
+
+  free(placed);
+  return FAT12_OK;
+}
+
+static bool fat12_name_valid(const char *input) {
+  int base = 0, ext = 0;
+  bool dot = false;
+  for (const char *p = input; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c == '.') {
+      if (dot || base == 0) return false;
+      dot = true;
+    } else if (c <= ' ' || strchr("\"*+,/:;<=>?[\\]|", c)) {
+      return false;
+    } else if (dot) {
+      ext++;
+    } else {
+      base++;
+    }
+  }
+  return base >= 1 && base <= 8 && ext <= 3 && !(dot && ext == 0);
+}
+
+static fat12_err_t fat12_build_check_names(const fat12_build_file_t *files, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    if (!files[i].name || !fat12_name_valid(files[i].name))
+      return FAT12_ERR_INVALID;
+
+    char name8[8], ext3[3];
+    fat12_format_name(files[i].name, name8, ext3);
+    for (uint16_t j = 0; j < i; j++) {
+      char other8[8], other3[3];
+      fat12_format_name(files[j].name, other8, other3);
+      if (memcmp(name8, other8, 8) == 0 && memcmp(ext3, other3, 3) == 0)
+        return FAT12_ERR_INVALID;
+    }
+  }
+  return FAT12_OK;
+}
+
+uint16_t fat12_build_cluster_lba(uint16_t cluster) {
+  fat12_layout_t lay;
+  fat12_init_hd_layout(&lay);
+  return lay.data_start_sector + (cluster - 2) * lay.bpb.sectors_per_cluster;
+}
+
+fat12_err_t fat12_build_layout(fat12_build_file_t *files, uint16_t count,
+                               bool volume_label) {
+  fat12_layout_t lay;
+  fat12_init_hd_layout(&lay);
+
+  if (count + (volume_label ? 1 : 0) > lay.bpb.root_entries)
+    return FAT12_ERR_FULL;
+
+  uint32_t data_clusters = lay.bpb.total_sectors - lay.data_start_sector;
+  uint32_t total = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    uint32_t n = (files[i].size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    if (files[i].size > UINT32_MAX - SECTOR_SIZE || n > data_clusters)
+      return FAT12_ERR_FULL;
+    total += n;
+    if (total > data_clusters) return FAT12_ERR_FULL;
+  }
+
+  fat12_err_t names = fat12_build_check_names(files, count);
+  if (names != FAT12_OK) return names;
+
+  fat12_err_t err = fat12_build_place(&lay, files, count, true);
+  if (err == FAT12_ERR_FULL)
+    err = fat12_build_place(&lay, files, count, false);
+  return err;
+}
+
+static void fat12_build_set_entry(uint8_t *fat, uint16_t cluster, uint16_t value) {
+  uint32_t off = cluster + (cluster / 2);
+  if (cluster & 1) {
+    fat[off] = (fat[off] & 0x0F) | ((value & 0x0F) << 4);
+    fat[off + 1] = value >> 4;
+  } else {
+    fat[off] = value & 0xFF;
+    fat[off + 1] = (fat[off + 1] & 0xF0) | ((value >> 8) & 0x0F);
+  }
+}
+
+static fat12_err_t fat12_build_fill_data(sector_t *s, uint16_t cluster,
+                                         const fat12_build_file_t *files,
+                                         uint16_t count) {
+  memset(s->data, 0, SECTOR_SIZE);
+  for (uint16_t i = 0; i < count; i++) {
+    const fat12_build_file_t *f = &files[i];
+    uint32_t n = (f->size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    if (n == 0 || cluster < f->start_cluster || cluster >= f->start_cluster + n)
+      continue;
+
+    uint32_t offset = (uint32_t)(cluster - f->start_cluster) * SECTOR_SIZE;
+    uint32_t len = f->size - offset;
+    if (len > SECTOR_SIZE) len = SECTOR_SIZE;
+    if (!f->read(f->ctx, offset, s->data, len))
+      return FAT12_ERR_READ;
+    return FAT12_OK;
+  }
+  s->valid = false;
+  return FAT12_OK;
+}
+
+fat12_err_t fat12_build(fat12_io_t io, const char *volume_label,
+                        fat12_build_file_t *files, uint16_t count,
+                        bool write_all_tracks) {
+  if (io.write == NULL)
+    return FAT12_ERR_INVALID;
+
+  fat12_err_t err = fat12_build_layout(files, count, volume_label != NULL);
+  if (err != FAT12_OK) return err;
+
+  fat12_layout_t lay;
+  fat12_init_hd_layout(&lay);
+
+  uint8_t boot[SECTOR_SIZE];
+  fat12_build_boot_sector(boot, &lay.bpb, volume_label);
+
+  uint8_t *fat = (uint8_t *)calloc(lay.bpb.sectors_per_fat, SECTOR_SIZE);
+  uint8_t *root = (uint8_t *)calloc(lay.root_dir_sectors, SECTOR_SIZE);
+  if (!fat || !root) {
+    free(fat);
+    free(root);
+    return FAT12_ERR_INVALID;
+  }
+
+  fat[0] = lay.bpb.media_descriptor;
+  fat[1] = 0xFF;
+  fat[2] = 0xFF;
+
+  uint16_t dirent = 0;
+  if (volume_label) {
+    fat12_build_volume_label(root, volume_label);
+    dirent++;
+  }
+
+  uint16_t last_lba = lay.data_start_sector - 1;
+  for (uint16_t i = 0; i < count; i++) {
+    fat12_build_file_t *f = &files[i];
+    uint32_t n = (f->size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    fat12_dirent_t *d = (fat12_dirent_t *)(root + dirent * FAT12_DIR_ENTRY_SIZE);
+    char name8[8], ext3[3];
+    fat12_format_name(f->name, name8, ext3);
+    fat12_init_dirent(d, name8, ext3);
+    d->start_cluster = f->start_cluster;
+    d->size = f->size;
+    dirent++;
+
+    for (uint32_t c = 0; c < n; c++) {
+      uint16_t cluster = f->start_cluster + c;
+      fat12_build_set_entry(fat, cluster, c + 1 < n ? cluster + 1 : 0xFFF);
+    }
+    if (n > 0) {
+      uint16_t lba = lay.data_start_sector + f->start_cluster - 2 + n - 1;
+      if (lba > last_lba) last_lba = lba;
+    }
+  }
+
+  uint16_t fat2_start = lay.fat_start_sector + lay.bpb.sectors_per_fat;
+  uint16_t spt = lay.bpb.sectors_per_track;
+  uint16_t tracks = lay.bpb.total_sectors / spt;
+  if (!write_all_tracks) tracks = last_lba / spt + 1;
+
+  for (uint16_t ti = 0; ti < tracks && err == FAT12_OK; ti++) {
+    static track_t t;
+    memset(&t, 0, sizeof(t));
+    t.track = ti / lay.bpb.num_heads;
+    t.side = ti % lay.bpb.num_heads;
+
+    for (uint16_t s = 0; s < spt && err == FAT12_OK; s++) {
+      uint16_t lba = ti * spt + s;
+      sector_t *sec = &t.sectors[s];
+      sec->track = t.track;
+      sec->side = t.side;
+      sec->sector_n = s + 1;
+      sec->size_code = 2;
+      sec->valid = true;
+
+      if (lba == 0) {
+        memcpy(sec->data, boot, SECTOR_SIZE);
+      } else if (lba >= lay.fat_start_sector && lba < fat2_start) {
+        memcpy(sec->data, fat + (lba - lay.fat_start_sector) * SECTOR_SIZE, SECTOR_SIZE);
+      } else if (lba >= fat2_start && lba < lay.root_dir_start_sector) {
+        memcpy(sec->data, fat + (lba - fat2_start) * SECTOR_SIZE, SECTOR_SIZE);
+      } else if (lba >= lay.root_dir_start_sector && lba < lay.data_start_sector) {
+        memcpy(sec->data, root + (lba - lay.root_dir_start_sector) * SECTOR_SIZE,
+               SECTOR_SIZE);
+      } else {
+        err = fat12_build_fill_data(sec, lba - lay.data_start_sector + 2, files, count);
+        if (write_all_tracks) sec->valid = true;
+      }
+    }
+
+    if (err == FAT12_OK && !io.write(io.ctx, &t))
+      err = FAT12_ERR_WRITE;
+  }
+
+  free(fat);
+  free(root);
+  return err;
+}
@@ -100,6 +100,14 @@ typedef struct {
 #define FAT12_DIRENT_END      0x00
 
 #define FAT12_WRITE_BATCH_MAX 36
+#define FAT12_BUILD_MAX_GAPS 32
+#define FAT12_SMALL_FILE_MAX 8192
+#define FAT12_LARGE_ZONE_CYLINDER 8
+
+typedef enum {
+  FAT12_ALLOC_FIRST_FIT = 0,
+  FAT12_ALLOC_LOCALITY,
+} fat12_alloc_t;
 
 typedef struct fat12 fat12_t;
 
@@ -126,6 +134,8 @@ struct fat12 {
   bool batch_in_use;
 
   uint16_t next_free_hint;
+  uint16_t large_free_hint;
+  fat12_alloc_t alloc_policy;
   bool fat_mismatch;
 };
 
@@ -165,10 +175,26 @@ typedef struct {
   uint16_t prev_cluster;
   uint32_t bytes_written;
   uint16_t cluster_offset;
+  uint32_t size_hint;
+  bool rewrite;
 } fat12_writer_t;
 
+typedef struct {
+  const char *name;
+  uint32_t size;
+  bool (*read)(void *ctx, uint32_t offset, uint8_t *buf, uint16_t len);
+  void *ctx;
+  uint16_t start_cluster;
+} fat12_build_file_t;
+
 fat12_err_t fat12_init(fat12_t *fat, fat12_io_t io);
 fat12_err_t fat12_format(fat12_io_t io, const char *volume_label, bool write_all_tracks);
+fat12_err_t fat12_build_layout(fat12_build_file_t *files, uint16_t count,
+                               bool volume_label);
+uint16_t fat12_build_cluster_lba(uint16_t cluster);
+fat12_err_t fat12_build(fat12_io_t io, const char *volume_label,
+                        fat12_build_file_t *files, uint16_t count,
+                        bool write_all_tracks);
 
 fat12_err_t fat12_get_entry(fat12_t *fat, uint16_t cluster, uint16_t *next);
 bool fat12_is_eof(uint16_t cluster);
@@ -184,10 +210,13 @@ int fat12_read(fat12_file_t *file, uint8_t *buf, uint16_t len);
 fat12_err_t fat12_read_cluster(fat12_t *fat, uint16_t cluster, uint8_t *buf);
 
 fat12_err_t fat12_open_write(fat12_t *fat, const char *filename, fat12_writer_t *writer);
+void fat12_set_size_hint(fat12_writer_t *writer, uint32_t size);
 int fat12_write(fat12_writer_t *writer, const uint8_t *buf, uint16_t len);
 fat12_err_t fat12_close_write(fat12_writer_t *writer);
 fat12_err_t fat12_create(fat12_t *fat, const char *filename, fat12_dirent_t *entry);
 fat12_err_t fat12_delete(fat12_t *fat, const char *filename);
+fat12_err_t fat12_reserve_clusters(fat12_t *fat, uint16_t first, uint16_t count);
+fat12_err_t fat12_release_clusters(fat12_t *fat, uint16_t first, uint16_t count);
 
 _Static_assert(sizeof(fat12_dirent_t) == 32, "fat12_dirent_t must be 32 bytes");
 
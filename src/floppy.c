@@ -170,7 +170,9 @@ static floppy_status_t floppy_seek_track0(floppy_t *f) {
   }
   return FLOPPY_ERR_NO_TRACK0;
 }
+#ifndef FLOPPY_READ_TRACK_ATTEMPTS
 #define FLOPPY_READ_TRACK_ATTEMPTS 15
+#endif
 #define FLOPPY_WRITE_ATTEMPTS 3
 #define FLOPPY_HEAD_SETTLE_MS 20
 
@@ -181,9 +183,35 @@ static void floppy_jog(floppy_t *f, uint8_t track, uint8_t distance) {
   sleep_ms(FLOPPY_HEAD_SETTLE_MS);
 }
 
+static void floppy_note_access(floppy_t *f, uint8_t track) {
+  if (track >= FLOPPY_TRACKS) track = FLOPPY_TRACKS - 1;
+
+  floppy_seek_stats_t *st = &f->seek_stats;
+  uint8_t from = f->track;
+  st->seeks++;
+  st->seek_steps += track > from ? track - from : from - track;
+  if (f->parked) {
+    uint8_t was = f->park_from;
+    int without = track > was ? track - was : was - track;
+    int with = track > from ? track - from : from - track;
+    st->saved_steps += without - with;
+    f->parked = false;
+  }
+
+  if (f->access_total >= FLOPPY_PARK_DECAY_AT) {
+    f->access_total = 0;
+    for (int i = 0; i < FLOPPY_TRACKS; i++) {
+      f->access[i] /= 2;
+      f->access_total += f->access[i];
+    }
+  }
+  f->access[track]++;
+  f->access_total++;
+}
+
 typedef bool (*sector_callback_t)(sector_t *sector, void *ctx);
 
-static floppy_status_t floppy_read_flux(floppy_t *f, int track, int side,
+static floppy_status_t floppy_read_flux(floppy_t *f, int track, int side, int revs,
                                         sector_callback_t cb, void *ctx) {
   floppy_seek(f, track);
   floppy_side_select(f, side);
@@ -197,8 +225,9 @@ static floppy_status_t floppy_read_flux(floppy_t *f, int track, int side,
   uint16_t prev = flux_read_wait(f) >> 1;
   bool ix_prev = false;
   floppy_status_t res = FLOPPY_ERR_TIMEOUT;
+  int ix_edges = 0;
 
-  for (int ix_edges = 0; ix_edges < FLOPPY_READ_TRACK_ATTEMPTS * 2;) {
+  while (ix_edges < revs * 2) {
     uint16_t value = flux_read_wait(f);
     uint8_t ix = value & 1;
     uint16_t cnt = value >> 1;
@@ -212,14 +241,16 @@ static floppy_status_t floppy_read_flux(floppy_t *f, int track, int side,
       if (sector.valid && sector.sector_n >= 1 && sector.sector_n <= SECTORS_PER_TRACK) {
         if (sector.track != track) {
           FLOPPY_ERR("[floppy] wrong track: expected %d, got %d\n", track, sector.track);
-          floppy_flux_read_stop(f);
-          return FLOPPY_ERR_WRONG_TRACK;
+          res = FLOPPY_ERR_WRONG_TRACK;
+          break;
         }
         if (sector.side != side) {
           FLOPPY_ERR("[floppy] wrong side: expected %d, got %d\n", side, sector.side);
-          floppy_flux_read_stop(f);
-          return FLOPPY_ERR_WRONG_SIDE;
+          res = FLOPPY_ERR_WRONG_SIDE;
+          break;
         }
+        f->last_sector_n = sector.sector_n;
+        floppy_sink_sector(f, &sector);
         if (cb(&sector, ctx)) {
           res = FLOPPY_OK;
           break;
@@ -230,6 +261,82 @@ static floppy_status_t floppy_read_flux(floppy_t *f, int track, int side,
   }
 
   floppy_flux_read_stop(f);
+  f->last_read_revs = ix_edges >= revs * 2 ? revs : ix_edges / 2 + 1;
+  uint32_t records = mfm.sectors_read + mfm.crc_errors;
+  f->last_read_margin = records ? mfm.sectors_read * 100 / records : 0;
+  return res;
+}
+
+static floppy_history_t *floppy_history_slot(floppy_t *f, int track, int side) {
+  if (track >= FLOPPY_TRACKS) track = FLOPPY_TRACKS - 1;
+  return &f->history[track][side & 1];
+}
+
+static void floppy_history_record(floppy_history_t *h, floppy_recover_t s, bool ok) {
+  uint8_t *c = ok ? &h->ok[s] : &h->fail[s];
+  if (*c < 255) (*c)++;
+}
+
+static bool floppy_recover_useless(const floppy_history_t *h, floppy_recover_t s) {
+  return h->fail[s] >= h->ok[s] + FLOPPY_HISTORY_SKIP_FAILS;
+}
+
+static bool floppy_recover_proven(const floppy_history_t *h, floppy_recover_t s) {
+  return h->ok[s] > h->fail[s];
+}
+
+static int floppy_recover_order(const floppy_history_t *h, const floppy_recover_t *ladder,
+                                int len, floppy_recover_t *order) {
+  int n = 0;
+  for (int i = 0; i < len; i++) {
+    if (floppy_recover_proven(h, ladder[i])) {
+      order[n++] = ladder[i];
+      break;
+    }
+  }
+  for (int i = 0; i < len; i++) {
+    if (n > 0 && order[0] == ladder[i]) continue;
+    if (floppy_recover_useless(h, ladder[i])) continue;
+    order[n++] = ladder[i];
+  }
+  if (n == 0) {
+    for (int i = 0; i < len; i++) order[n++] = ladder[i];
+  }
+  return n;
+}
+
+static int floppy_recover_budget(const floppy_history_t *h, floppy_recover_t s, floppy_op_t op) {
+  if (!floppy_recover_proven(h, s) || h->revs[op] == 0) return FLOPPY_READ_TRACK_ATTEMPTS;
+  int revs = h->revs[op] * 2 + 1;
+  return revs < FLOPPY_READ_TRACK_ATTEMPTS ? revs : FLOPPY_READ_TRACK_ATTEMPTS;
+}
+
+static floppy_status_t floppy_read_recover(floppy_t *f, int track, int side,
+                                           sector_callback_t cb, void *ctx,
+                                           floppy_op_t op) {
+  static const floppy_recover_t ladder[] = {
+    FLOPPY_RECOVER_READ, FLOPPY_RECOVER_JOG10, FLOPPY_RECOVER_JOG20,
+  };
+  floppy_history_t *h = floppy_history_slot(f, track, side);
+  floppy_recover_t order[3];
+  int n = floppy_recover_order(h, ladder, 3, order);
+
+  floppy_status_t res = FLOPPY_ERR_TIMEOUT;
+  for (int i = 0; i < n; i++) {
+    if (order[i] == FLOPPY_RECOVER_JOG10) floppy_jog(f, track, 10);
+    if (order[i] == FLOPPY_RECOVER_JOG20) floppy_jog(f, track, 20);
+
+    res = floppy_read_flux(f, track, side, floppy_recover_budget(h, order[i], op), cb, ctx);
+    if (h->total_revs < 0xFFFF - f->last_read_revs) h->total_revs += f->last_read_revs;
+    floppy_history_record(h, order[i], res == FLOPPY_OK);
+
+    if (res == FLOPPY_OK) {
+      h->revs[op] = f->last_read_revs;
+      h->margin = f->last_read_margin;
+      return res;
+    }
+    if (res != FLOPPY_ERR_TIMEOUT && op == FLOPPY_OP_SECTOR) return res;
+  }
   return res;
 }
 
@@ -261,15 +368,7 @@ need_read:;
   struct complete_track_ctx ctx = { .t = t };
   uint8_t target = t->track;
 
-  floppy_status_t res = floppy_read_flux(f, target, t->side, complete_track_cb, &ctx);
-  if (res == FLOPPY_OK) return res;
-
-  floppy_jog(f, target, 10);
-  res = floppy_read_flux(f, target, t->side, complete_track_cb, &ctx);
-  if (res == FLOPPY_OK) return res;
-
-  floppy_jog(f, target, 20);
-  res = floppy_read_flux(f, target, t->side, complete_track_cb, &ctx);
+  floppy_status_t res = floppy_read_recover(f, target, t->side, complete_track_cb, &ctx, FLOPPY_OP_TRACK);
 
   if (res == FLOPPY_ERR_TIMEOUT) {
     FLOPPY_ERR("[floppy] timeout reading track %d side %d, missing sectors:", target, t->side);
@@ -297,7 +396,7 @@ static bool read_sector_cb(sector_t *sector, void *ctx) {
 
 static floppy_status_t floppy_read_internal(floppy_t *f, int track, int side, int sector_n, sector_t *out) {
   struct read_sector_ctx ctx = { .sector_n = sector_n, .out = out };
-  floppy_status_t res = floppy_read_flux(f, track, side, read_sector_cb, &ctx);
+  floppy_status_t res = floppy_read_recover(f, track, side, read_sector_cb, &ctx, FLOPPY_OP_SECTOR);
 
   if (res == FLOPPY_ERR_TIMEOUT) {
     FLOPPY_ERR("[floppy] timeout reading track %d side %d sector %d\n", track, side, sector_n);
@@ -346,6 +445,14 @@ void floppy_init(floppy_t *f) {
   f->motor_on = false;
   f->selected = false;
   f->auto_motor = true;
+  f->index_free_write = false;
+  f->last_sector_n = 0;
+  floppy_reset_history(f);
+  f->park_policy = FLOPPY_PARK_STAY;
+  f->parked = false;
+  f->park_from = 0;
+  memset(&f->seek_stats, 0, sizeof(f->seek_stats));
+  floppy_reset_access(f);
   f->last_io_time_ms = 0;
 
   add_repeating_timer_ms(IDLE_CHECK_INTERVAL_MS, floppy_idle_timer_callback, f, &f->idle_timer);
@@ -408,6 +515,8 @@ bool floppy_disk_changed(floppy_t *f) {
   bool changed = !gpio_get(f->pins.disk_change);
 
   if (changed) {
+    floppy_reset_history(f);
+    floppy_reset_access(f);
     if (f->track > 0) {
       floppy_step(f, DIR_OUTWARD);
       floppy_step(f, DIR_INWARD);
@@ -424,42 +533,132 @@ bool floppy_write_protected(floppy_t *f) {
   return !gpio_get(f->pins.write_protect);
 }
 
+void floppy_reset_history(floppy_t *f) {
+  memset(f->history, 0, sizeof(f->history));
+}
+
+const floppy_history_t *floppy_track_history(floppy_t *f, uint8_t track, uint8_t side) {
+  return floppy_history_slot(f, track, side);
+}
+
+uint8_t floppy_park_target(floppy_t *f) {
+  switch (f->park_policy) {
+  case FLOPPY_PARK_TRACK0:
+    return 0;
+  case FLOPPY_PARK_MEDIAN:
+    if (f->access_total == 0) return f->track;
+    uint32_t sum = 0;
+    for (int i = 0; i < FLOPPY_TRACKS; i++) {
+      sum += f->access[i];
+      if (sum * 2 >= f->access_total) return i;
+    }
+    return FLOPPY_TRACKS - 1;
+  default:
+    return f->track;
+  }
+}
+
+floppy_status_t floppy_park(floppy_t *f) {
+  if (f->park_policy == FLOPPY_PARK_STAY || !f->selected) return FLOPPY_OK;
+
+  uint8_t from = f->parked ? f->park_from : f->track;
+  uint8_t target = floppy_park_target(f);
+  uint8_t start = f->track;
+  floppy_status_t s = f->park_policy == FLOPPY_PARK_TRACK0 ? floppy_seek_track0(f)
+                                                           : floppy_seek(f, target);
+  if (s != FLOPPY_OK) return s;
+
+  f->seek_stats.parks++;
+  f->seek_stats.park_steps += f->track > start ? f->track - start : start - f->track;
+  f->parked = true;
+  f->park_from = from;
+  return FLOPPY_OK;
+}
+
+bool floppy_idle(floppy_t *f) {
+  if (f->park_policy == FLOPPY_PARK_STAY || f->parked || !f->selected) return false;
+
+  uint32_t now = to_ms_since_boot(get_absolute_time());
+  if (now - f->last_io_time_ms < FLOPPY_PARK_IDLE_MS) return false;
+
+  return floppy_park(f) == FLOPPY_OK;
+}
+
+void floppy_reset_access(floppy_t *f) {
+  memset(f->access, 0, sizeof(f->access));
+  f->access_total = 0;
+}
+
+void floppy_set_sink(floppy_t *f, floppy_sink_t sink, void *ctx) {
+  f->sink = sink;
+  f->sink_ctx = ctx;
+}
+
+void floppy_sink_sector(floppy_t *f, const sector_t *sector) {
+  if (!f->sink) return;
+  f->sink(f->sink_ctx, sector);
+  f->sunk++;
+}
+
 floppy_status_t floppy_read_sector(floppy_t *f, sector_t *sector) {
   sector->valid = false;
   floppy_prepare(f);
-  uint8_t target = sector->track;
+  floppy_note_access(f, sector->track);
+  return floppy_read_internal(f, sector->track, sector->side, sector->sector_n, sector);
+}
 
-  floppy_status_t st = floppy_read_internal(f, target, sector->side, sector->sector_n, sector);
-  if (st != FLOPPY_ERR_TIMEOUT) return st;
+struct read_quick_ctx {
+  int sector_n;
+  sector_t *out;
+  uint32_t seen;
+};
 
-  floppy_jog(f, target, 10);
-  st = floppy_read_internal(f, target, sector->side, sector->sector_n, sector);
-  if (st != FLOPPY_ERR_TIMEOUT) return st;
+static bool read_quick_cb(sector_t *sector, void *ctx) {
+  struct read_quick_ctx *c = (struct read_quick_ctx *)ctx;
+  if (sector->sector_n == c->sector_n) *c->out = *sector;
+  c->seen |= 1u << (sector->sector_n - 1);
+  return c->seen == (1u << SECTORS_PER_TRACK) - 1;
+}
 
-  floppy_jog(f, target, 20);
-  return floppy_read_internal(f, target, sector->side, sector->sector_n, sector);
+floppy_status_t floppy_read_sector_quick(floppy_t *f, sector_t *sector) {
+  sector->valid = false;
+  floppy_prepare(f);
+  floppy_note_access(f, sector->track);
+  struct read_quick_ctx ctx = { .sector_n = sector->sector_n, .out = sector };
+  floppy_status_t res = floppy_read_flux(f, sector->track, sector->side, 2, read_quick_cb, &ctx);
+  if (res == FLOPPY_OK || res == FLOPPY_ERR_TIMEOUT) {
+    return sector->valid ? FLOPPY_OK : FLOPPY_ERR_TIMEOUT;
+  }
+  return res;
 }
 
 struct verify_ctx {
   const track_t *expected;
   bool verified[SECTORS_PER_TRACK];
+  bool strict;
+  bool stale;
+  int seen;
 };
 
 static bool verify_track_cb(sector_t *sector, void *ctx) {
   struct verify_ctx *v = (struct verify_ctx *)ctx;
   int idx = sector->sector_n - 1;
+  bool match = sector->track == v->expected->sectors[idx].track &&
+               sector->side == v->expected->sectors[idx].side &&
+               memcmp(sector->data, v->expected->sectors[idx].data, SECTOR_SIZE) == 0;
 
-  if (!v->verified[idx] &&
-      sector->track == v->expected->sectors[idx].track &&
-      sector->side == v->expected->sectors[idx].side &&
-      memcmp(sector->data, v->expected->sectors[idx].data, SECTOR_SIZE) == 0) {
+  if (match) {
     v->verified[idx] = true;
+  } else if (v->strict) {
+    v->stale = true;
+    return true;
   }
+  v->seen++;
 
   for (int i = 0; i < SECTORS_PER_TRACK; i++) {
     if (!v->verified[i]) return false;
   }
-  return true;
+  return !v->strict || v->seen > SECTORS_PER_TRACK;
 }
 
 floppy_status_t floppy_write_track(floppy_t *f, track_t *t) {
@@ -469,7 +668,9 @@ floppy_status_t floppy_write_track(floppy_t *f, track_t *t) {
   }
 
   floppy_prepare(f);
+  floppy_note_access(f, t->track);
 
+  f->last_sector_n = 0;
   floppy_status_t status = floppy_complete_track(f, t);
   if (status != FLOPPY_OK) {
     return status;
@@ -482,30 +683,55 @@ floppy_status_t floppy_write_track(floppy_t *f, track_t *t) {
 #endif
   mfm_encode_t enc;
   mfm_encode_init(&enc, flux_buf, sizeof(flux_buf));
-  mfm_encode_track(&enc, t);
+  if (f->index_free_write) {
+    mfm_encode_track_from(&enc, t, f->last_sector_n % SECTORS_PER_TRACK + 1);
+  } else {
+    mfm_encode_track(&enc, t);
+  }
+
+  floppy_history_t *h = floppy_history_slot(f, t->track, t->side);
+  int recal_at = 2;
+  if (floppy_recover_proven(h, FLOPPY_RECOVER_RECAL) &&
+      floppy_recover_useless(h, FLOPPY_RECOVER_WRITE)) {
+    recal_at = 0;
+  }
 
   for (int attempt = 0; attempt < FLOPPY_WRITE_ATTEMPTS; attempt++) {
-    if (attempt == 2) {
+    floppy_recover_t strategy = FLOPPY_RECOVER_WRITE;
+    if (attempt == recal_at) {
       floppy_seek_track0(f);
+      strategy = FLOPPY_RECOVER_RECAL;
     }
 
     floppy_seek(f, t->track);
     floppy_side_select(f, t->side);
-    floppy_wait_for_index(f);
+    if (!f->index_free_write) {
+      floppy_wait_for_index(f);
+    }
     floppy_flux_write_start(f);
     for (size_t i = 0; i < enc.pos; i++) {
       pio_sm_put_blocking(f->write.pio, f->write.sm, flux_buf[i]);
     }
     floppy_flux_write_stop(f);
 
-    struct verify_ctx vctx = { .expected = t };
-    for (int verify = 0; verify < 3; verify++) {
+    struct verify_ctx vctx = { .expected = t, .strict = f->index_free_write };
+    for (int verify = 0; verify < 3 && !vctx.stale; verify++) {
       floppy_jog(f, t->track, 10);
-      if (floppy_read_flux(f, t->track, t->side, verify_track_cb, &vctx) == FLOPPY_OK) {
+      vctx.seen = 0;
+      if (floppy_read_flux(f, t->track, t->side, FLOPPY_READ_TRACK_ATTEMPTS,
+                           verify_track_cb, &vctx) == FLOPPY_OK &&
+          !vctx.stale) {
+        floppy_history_record(h, strategy, true);
         return FLOPPY_OK;
       }
     }
+    floppy_history_record(h, strategy, false);
 
+    if (vctx.stale) {
+      FLOPPY_ERR("[floppy] verify found stale sector track %d side %d attempt %d\n",
+                 t->track, t->side, attempt + 1);
+      continue;
+    }
     FLOPPY_ERR("[floppy] verify failed track %d side %d attempt %d, bad sectors:",
                t->track, t->side, attempt + 1);
     for (int i = 0; i < SECTORS_PER_TRACK; i++) {
@@ -519,6 +745,7 @@ floppy_status_t floppy_write_track(floppy_t *f, track_t *t) {
 
 floppy_status_t floppy_read_track(floppy_t *f, track_t *t) {
   floppy_prepare(f);
+  floppy_note_access(f, t->track);
   for (int i = 0; i < SECTORS_PER_TRACK; i++)
     t->sectors[i].valid = false;
   return floppy_complete_track(f, t);
@@ -534,6 +761,11 @@ bool floppy_io_read(void *ctx, sector_t *sector) {
   return floppy_read_sector(f, sector) == FLOPPY_OK;
 }
 
+bool floppy_io_read_quick(void *ctx, sector_t *sector) {
+  floppy_t *f = (floppy_t *)ctx;
+  return floppy_read_sector_quick(f, sector) == FLOPPY_OK;
+}
+
 bool floppy_io_write(void *ctx, track_t *track) {
   floppy_t *f = (floppy_t *)ctx;
   return floppy_write_track(f, track) == FLOPPY_OK;
@@ -548,3 +780,8 @@ bool floppy_io_write_protected(void *ctx) {
   floppy_t *f = (floppy_t *)ctx;
   return floppy_write_protected(f);
 }
+
+void floppy_io_set_sink(void *ctx, floppy_sink_t sink, void *sink_ctx) {
+  floppy_t *f = (floppy_t *)ctx;
+  floppy_set_sink(f, sink, sink_ctx);
+}
@@ -65,8 +65,52 @@ typedef struct {
 
 #define FLOPPY_IDLE_TIMEOUT_MS 20000
 
+typedef enum {
+  FLOPPY_RECOVER_READ = 0,
+  FLOPPY_RECOVER_JOG10,
+  FLOPPY_RECOVER_JOG20,
+  FLOPPY_RECOVER_WRITE,
+  FLOPPY_RECOVER_RECAL,
+  FLOPPY_RECOVER_COUNT,
+} floppy_recover_t;
+
+#define FLOPPY_HISTORY_SKIP_FAILS 2
+
+typedef enum {
+  FLOPPY_OP_SECTOR = 0,
+  FLOPPY_OP_TRACK,
+  FLOPPY_OP_COUNT,
+} floppy_op_t;
+
+typedef struct {
+  uint8_t ok[FLOPPY_RECOVER_COUNT];
+  uint8_t fail[FLOPPY_RECOVER_COUNT];
+  uint8_t revs[FLOPPY_OP_COUNT];
+  uint8_t margin;
+  uint16_t total_revs;
+} floppy_history_t;
+
+typedef enum {
+  FLOPPY_PARK_STAY = 0,
+  FLOPPY_PARK_TRACK0,
+  FLOPPY_PARK_MEDIAN,
+} floppy_park_t;
+
+#define FLOPPY_PARK_IDLE_MS 500
+#define FLOPPY_PARK_DECAY_AT 256
+
+typedef struct {
+  uint32_t seeks;
+  uint32_t seek_steps;
+  uint32_t parks;
+  uint32_t park_steps;
+  int32_t saved_steps;
+} floppy_seek_stats_t;
+
 typedef struct floppy floppy_t;
 
+typedef void (*floppy_sink_t)(void *ctx, const sector_t *sector);
+
 struct floppy {
   floppy_pins_t pins;
   floppy_pio_t read;
@@ -79,6 +123,20 @@ struct floppy {
   volatile bool selected;
 
   bool auto_motor;
+  bool index_free_write;
+  uint8_t last_sector_n;
+  uint8_t last_read_revs;
+  uint8_t last_read_margin;
+  floppy_history_t history[FLOPPY_TRACKS][2];
+  floppy_park_t park_policy;
+  bool parked;
+  uint8_t park_from;
+  uint16_t access[FLOPPY_TRACKS];
+  uint16_t access_total;
+  floppy_seek_stats_t seek_stats;
+  floppy_sink_t sink;
+  void *sink_ctx;
+  uint32_t sunk;
   volatile uint32_t last_io_time_ms;
   struct repeating_timer idle_timer;
 };
@@ -102,15 +160,29 @@ bool floppy_disk_changed(floppy_t *f);
 
 bool floppy_write_protected(floppy_t *f);
 
+void floppy_reset_history(floppy_t *f);
+const floppy_history_t *floppy_track_history(floppy_t *f, uint8_t track, uint8_t side);
+
+uint8_t floppy_park_target(floppy_t *f);
+floppy_status_t floppy_park(floppy_t *f);
+bool floppy_idle(floppy_t *f);
+void floppy_reset_access(floppy_t *f);
+
+void floppy_set_sink(floppy_t *f, floppy_sink_t sink, void *ctx);
+void floppy_sink_sector(floppy_t *f, const sector_t *sector);
+
 floppy_status_t floppy_read_sector(floppy_t *f, sector_t *sector);
+floppy_status_t floppy_read_sector_quick(floppy_t *f, sector_t *sector);
 floppy_status_t floppy_read_track(floppy_t *f, track_t *t);
 
 floppy_status_t floppy_write_track(floppy_t *f, track_t *track);
 
 bool floppy_io_read(void *ctx, sector_t *sector);
+bool floppy_io_read_quick(void *ctx, sector_t *sector);
 bool floppy_io_read_track(void *ctx, track_t *track);
 bool floppy_io_write(void *ctx, track_t *track);
 bool floppy_io_disk_changed(void *ctx);
 bool floppy_io_write_protected(void *ctx);
+void floppy_io_set_sink(void *ctx, floppy_sink_t sink, void *sink_ctx);
 
 #endif
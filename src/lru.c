@@ -36,6 +36,48 @@ static void lru_push_front(lru_t *lru, lru_entry_t *entry) {
   }
 }
 
+static void lru_insert_before(lru_t *lru, lru_entry_t *entry, lru_entry_t *at) {
+  if (!at) {
+    entry->next = NULL;
+    entry->prev = lru->tail;
+    if (lru->tail) {
+      lru->tail->next = entry;
+    } else {
+      lru->head = entry;
+    }
+    lru->tail = entry;
+    return;
+  }
+  entry->next = at;
+  entry->prev = at->prev;
+  if (at->prev) {
+    at->prev->next = entry;
+  } else {
+    lru->head = entry;
+  }
+  at->prev = entry;
+}
+
+static void lru_promote(lru_t *lru, lru_entry_t *entry) {
+  if (entry->offered) {
+    entry->offered = false;
+    lru->offered--;
+  }
+  if (entry != lru->head) {
+    lru_unlink(lru, entry);
+    lru_push_front(lru, entry);
+  }
+}
+
+static void lru_evict(lru_t *lru, lru_entry_t *entry) {
+  lru_unlink(lru, entry);
+  if (entry->offered) {
+    entry->offered = false;
+    lru->offered--;
+  }
+  lru->count--;
+}
+
 static lru_entry_t *lru_find(lru_t *lru, uint32_t key) {
   for (uint32_t i = 0; i < lru->max_entries; i++) {
     lru_entry_t *entry = lru_entry_at(lru, i);
@@ -63,6 +105,21 @@ static lru_entry_t *lru_find_evictable(lru_t *lru) {
   return NULL;
 }
 
+static lru_entry_t *lru_find_evictable_used(lru_t *lru) {
+  for (lru_entry_t *e = lru->tail; e; e = e->prev) {
+    if (!e->pinned && !e->offered) return e;
+  }
+  return NULL;
+}
+
+static lru_entry_t *lru_offered_top(lru_t *lru) {
+  lru_entry_t *top = NULL;
+  for (lru_entry_t *e = lru->tail; e && e->offered; e = e->prev) {
+    top = e;
+  }
+  return top;
+}
+
 lru_t *lru_init(uint32_t max_entries, uint32_t elem_size) {
   if (max_entries == 0 || elem_size == 0) return NULL;
 
@@ -84,6 +141,8 @@ lru_t *lru_init(uint32_t max_entries, uint32_t elem_size) {
   lru->elem_size = elem_size;
   lru->entry_stride = entry_stride;
   lru->count = 0;
+  lru->offered = 0;
+  lru->offer_limit = 0;
 
   return lru;
 }
@@ -100,11 +159,7 @@ void *lru_get(lru_t *lru, uint32_t key) {
   lru_entry_t *entry = lru_find(lru, key);
   if (!entry) return NULL;
 
-  if (entry != lru->head) {
-    lru_unlink(lru, entry);
-    lru_push_front(lru, entry);
-  }
-
+  lru_promote(lru, entry);
   return lru_entry_value(entry);
 }
 
@@ -118,10 +173,7 @@ void *lru_set(lru_t *lru, uint32_t key, const void *value) {
       memcpy(dest, value, lru->elem_size);
     }
 
-    if (entry != lru->head) {
-      lru_unlink(lru, entry);
-      lru_push_front(lru, entry);
-    }
+    lru_promote(lru, entry);
     return dest;
   }
 
@@ -130,8 +182,7 @@ void *lru_set(lru_t *lru, uint32_t key, const void *value) {
     entry = lru_find_evictable(lru);
     if (!entry) return NULL;
 
-    lru_unlink(lru, entry);
-    lru->count--;
+    lru_evict(lru, entry);
   }
 
   entry->key = key;
@@ -156,10 +207,7 @@ void *lru_get_or_create(lru_t *lru, uint32_t key, bool *is_new) {
   if (entry) {
     if (is_new) *is_new = false;
 
-    if (entry != lru->head) {
-      lru_unlink(lru, entry);
-      lru_push_front(lru, entry);
-    }
+    lru_promote(lru, entry);
     return lru_entry_value(entry);
   }
 
@@ -170,8 +218,7 @@ void *lru_get_or_create(lru_t *lru, uint32_t key, bool *is_new) {
     entry = lru_find_evictable(lru);
     if (!entry) return NULL;
 
-    lru_unlink(lru, entry);
-    lru->count--;
+    lru_evict(lru, entry);
   }
 
   entry->key = key;
@@ -185,11 +232,51 @@ void *lru_get_or_create(lru_t *lru, uint32_t key, bool *is_new) {
   return dest;
 }
 
+void *lru_offer(lru_t *lru, uint32_t key, const void *value) {
+  if (!lru || lru_find(lru, key)) return NULL;
+
+  lru_entry_t *entry = lru_find_free(lru);
+  if (!entry && lru->offered < lru->offer_limit) {
+    entry = lru_find_evictable_used(lru);
+  }
+  if (!entry) {
+    for (lru_entry_t *e = lru->tail; e && !entry; e = e->prev) {
+      if (e->offered) entry = e;
+    }
+  }
+  if (!entry) return NULL;
+  if (entry->occupied) lru_evict(lru, entry);
+
+  entry->key = key;
+  entry->occupied = true;
+  entry->pinned = false;
+  entry->offered = true;
+  void *dest = lru_entry_value(entry);
+  if (value) {
+    memcpy(dest, value, lru->elem_size);
+  } else {
+    memset(dest, 0, lru->elem_size);
+  }
+  lru_insert_before(lru, entry, lru_offered_top(lru));
+  lru->offered++;
+  lru->count++;
+
+  return dest;
+}
+
+void lru_set_offer_limit(lru_t *lru, uint32_t limit) {
+  if (lru) lru->offer_limit = limit;
+}
+
 bool lru_pin(lru_t *lru, uint32_t key) {
   if (!lru) return false;
   lru_entry_t *entry = lru_find(lru, key);
   if (!entry) return false;
   entry->pinned = true;
+  if (entry->offered) {
+    entry->offered = false;
+    lru->offered--;
+  }
   return true;
 }
 
@@ -199,10 +286,9 @@ bool lru_remove(lru_t *lru, uint32_t key) {
   lru_entry_t *entry = lru_find(lru, key);
   if (!entry) return false;
 
-  lru_unlink(lru, entry);
+  lru_evict(lru, entry);
   entry->key = 0;
   entry->occupied = false;
-  lru->count--;
 
   return true;
 }
@@ -216,6 +302,7 @@ void lru_clear(lru_t *lru) {
       entry->key = 0;
       entry->occupied = false;
       entry->pinned = false;
+      entry->offered = false;
       entry->prev = NULL;
       entry->next = NULL;
     }
@@ -224,6 +311,7 @@ void lru_clear(lru_t *lru) {
   lru->head = NULL;
   lru->tail = NULL;
   lru->count = 0;
+  lru->offered = 0;
 }
 
 uint32_t lru_count(lru_t *lru) {
@@ -11,6 +11,7 @@ typedef struct lru_entry {
   struct lru_entry *next;
   bool occupied;
   bool pinned;
+  bool offered;
 } lru_entry_t;
 
 typedef struct {
@@ -21,6 +22,8 @@ typedef struct {
   uint32_t elem_size;
   uint32_t entry_stride;
   uint32_t count;
+  uint32_t offered;
+  uint32_t offer_limit;
 } lru_t;
 
 lru_t *lru_init(uint32_t max_entries, uint32_t elem_size);
@@ -33,6 +36,10 @@ void *lru_set(lru_t *lru, uint32_t key, const void *value);
 
 void *lru_get_or_create(lru_t *lru, uint32_t key, bool *is_new);
 
+void *lru_offer(lru_t *lru, uint32_t key, const void *value);
+
+void lru_set_offer_limit(lru_t *lru, uint32_t limit);
+
 bool lru_remove(lru_t *lru, uint32_t key);
 
 bool lru_pin(lru_t *lru, uint32_t key);
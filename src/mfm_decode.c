@@ -176,6 +176,7 @@ check_record:
       out->sector_n = m->pending_sector;
       out->size_code = m->pending_size_code;
       out->valid = crc_ok && !m->overflow;
+      m->data_mark = mark;
 
       uint16_t copy_size = size;
       if (copy_size > SECTOR_SIZE) copy_size = SECTOR_SIZE;
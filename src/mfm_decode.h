@@ -33,6 +33,7 @@ typedef struct {
   uint8_t pending_sector;
   uint8_t pending_size_code;
   bool have_pending_addr;
+  uint8_t data_mark;
 
   uint32_t syncs_found;
   uint32_t sectors_read;
@@ -27,10 +27,12 @@ void mfm_encode_init(mfm_encode_t *e, uint8_t *buf, size_t size) {
     e->pos = 0;
     e->prev_bit = 0;
     e->pending_cells = 0;
+    e->bytes = 0;
     e->overflow = false;
 }
 
 void mfm_encode_bytes(mfm_encode_t *e, const uint8_t *data, size_t len) {
+    e->bytes += len;
     for (size_t i = 0; i < len; i++) {
         uint8_t byte = data[i];
 
@@ -59,7 +61,10 @@ void mfm_encode_bytes(mfm_encode_t *e, const uint8_t *data, size_t len) {
 void mfm_encode_sync(mfm_encode_t *e) {
     uint8_t preamble[12] = {0};
     mfm_encode_bytes(e, preamble, 12);
+    mfm_encode_marks(e);
+}
 
+void mfm_encode_marks(mfm_encode_t *e) {
     static const uint8_t sync_pulses[] = {
         MFM_PULSE_MEDIUM, MFM_PULSE_LONG, MFM_PULSE_MEDIUM, MFM_PULSE_LONG, MFM_PULSE_MEDIUM,
         MFM_PULSE_SHORT,
@@ -71,6 +76,7 @@ void mfm_encode_sync(mfm_encode_t *e) {
     for (int i = 0; i < 15; i++) {
         mfm_encode_pulse(e, sync_pulses[i]);
     }
+    e->bytes += 3;
 
     e->prev_bit = 1;
     e->pending_cells = 0;
@@ -104,16 +110,19 @@ void mfm_encode_sector(mfm_encode_t *e, const sector_t *s) {
     mfm_encode_bytes(e, data_crc_bytes, 2);
 }
 
-static void mfm_encode_precomp(uint8_t *buf, size_t len, uint8_t track) {
-    if (len < 3) return;
-    int shift = MFM_PRECOMP_SHIFT + (track - MFM_PRECOMP_START_TRACK) / 13;
-    for (size_t i = 1; i < len - 1; i++) {
-        if (buf[i] != MFM_PULSE_SHORT) continue;
-        bool prev_long = (buf[i - 1] == MFM_PULSE_LONG);
-        bool next_long = (buf[i + 1] == MFM_PULSE_LONG);
-        if (prev_long && next_long) continue;
-        if (prev_long) buf[i] -= shift;
-        else if (next_long) buf[i] += shift;
+static void mfm_encode_precomp(uint8_t *buf, size_t len) {
+    if (len < 2) return;
+    uint8_t cur = buf[0];
+    for (size_t i = 0; i + 1 < len; i++) {
+        uint8_t next = buf[i + 1];
+        if (cur < next) {
+            buf[i] -= MFM_PRECOMP_SHIFT;
+            buf[i + 1] += MFM_PRECOMP_SHIFT;
+        } else if (cur > next) {
+            buf[i] += MFM_PRECOMP_SHIFT;
+            buf[i + 1] -= MFM_PRECOMP_SHIFT;
+        }
+        cur = next;
     }
 }
 
@@ -127,7 +136,31 @@ size_t mfm_encode_track(mfm_encode_t *e, const track_t *t) {
     }
 
     if (t->track >= MFM_PRECOMP_START_TRACK) {
-        mfm_encode_precomp(e->buf, e->pos, t->track);
+        mfm_encode_precomp(e->buf, e->pos);
+    }
+
+    return e->pos;
+}
+
+size_t mfm_encode_track_from(mfm_encode_t *e, const track_t *t, uint8_t first_sector) {
+    size_t start = e->bytes;
+    mfm_encode_gap(e, MFM_SPLICE_LEAD_GAP);
+
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        int idx = (first_sector + SECTORS_PER_TRACK - 1 + i) % SECTORS_PER_TRACK;
+        mfm_encode_sector(e, &t->sectors[idx]);
+
+        mfm_encode_gap(e, 54);
+    }
+
+    size_t total = MFM_TRACK_BYTES * (1000 + MFM_SPLICE_OVERLAP_PERMILLE) / 1000;
+    size_t used = e->bytes - start;
+    if (used < total) {
+        mfm_encode_gap(e, total - used);
+    }
+
+    if (t->track >= MFM_PRECOMP_START_TRACK) {
+        mfm_encode_precomp(e->buf, e->pos);
     }
 
     return e->pos;
@@ -19,12 +19,17 @@
 #define MFM_PRECOMP_SHIFT 3
 #define MFM_PRECOMP_START_TRACK 40
 
+#define MFM_TRACK_BYTES 12500
+#define MFM_SPLICE_LEAD_GAP 640
+#define MFM_SPLICE_OVERLAP_PERMILLE 25
+
 typedef struct {
     uint8_t *buf;
     size_t size;
     size_t pos;
     int prev_bit;
     int pending_cells;
+    size_t bytes;
     bool overflow;
 } mfm_encode_t;
 
@@ -34,10 +39,14 @@ void mfm_encode_bytes(mfm_encode_t *e, const uint8_t *data, size_t len);
 
 void mfm_encode_sync(mfm_encode_t *e);
 
+void mfm_encode_marks(mfm_encode_t *e);
+
 void mfm_encode_gap(mfm_encode_t *e, size_t count);
 
 void mfm_encode_sector(mfm_encode_t *e, const sector_t *s);
 
 size_t mfm_encode_track(mfm_encode_t *e, const track_t *t);
 
+size_t mfm_encode_track_from(mfm_encode_t *e, const track_t *t, uint8_t first_sector);
+
 #endif
@@ -0,0 +1,106 @@
+#include "parity.h"
+#include <string.h>
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static bool gf_ready;
+
+static void gf_init(void) {
+  if (gf_ready) return;
+  uint16_t x = 1;
+  for (int i = 0; i < 255; i++) {
+    gf_exp[i] = x;
+    gf_log[x] = i;
+    x <<= 1;
+    if (x & 0x100) x ^= 0x11D;
+  }
+  for (int i = 255; i < 512; i++) gf_exp[i] = gf_exp[i - 255];
+  gf_ready = true;
+}
+
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+  if (a == 0 || b == 0) return 0;
+  return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static uint8_t gf_div(uint8_t a, uint8_t b) {
+  if (a == 0) return 0;
+  return gf_exp[gf_log[a] + 255 - gf_log[b]];
+}
+
+static void gf_mul_add(uint8_t *dst, const uint8_t *src, size_t len, uint8_t g) {
+  if (g == 1) {
+    for (size_t k = 0; k < len; k++) dst[k] ^= src[k];
+    return;
+  }
+  uint8_t lg = gf_log[g];
+  for (size_t k = 0; k < len; k++) {
+    if (src[k]) dst[k] ^= gf_exp[gf_log[src[k]] + lg];
+  }
+}
+
+void parity_encode(const uint8_t *const data[], int n, size_t len, uint8_t *p, uint8_t *q) {
+  gf_init();
+  if (p) memset(p, 0, len);
+  if (q) memset(q, 0, len);
+  for (int i = 0; i < n; i++) {
+    if (p) gf_mul_add(p, data[i], len, 1);
+    if (q) gf_mul_add(q, data[i], len, gf_exp[i]);
+  }
+}
+
+static void parity_syndromes(uint8_t *const data[], int n, size_t len, const bool present[],
+                             uint8_t *ps, uint8_t *qs) {
+  for (int i = 0; i < n; i++) {
+    if (!present[i]) continue;
+    if (ps) gf_mul_add(ps, data[i], len, 1);
+    if (qs) gf_mul_add(qs, data[i], len, gf_exp[i]);
+  }
+}
+
+bool parity_rebuild(uint8_t *const data[], int n, size_t len, const bool present[],
+                    const uint8_t *p, const uint8_t *q) {
+  gf_init();
+  int missing[PARITY_MAX_SHARDS + 1];
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    if (present[i]) continue;
+    if (m == PARITY_MAX_SHARDS) return false;
+    missing[m++] = i;
+  }
+  if (m == 0) return true;
+  if (m > (p ? 1 : 0) + (q ? 1 : 0)) return false;
+
+  int x = missing[0];
+  uint8_t *dx = data[x];
+
+  if (m == 1 && p) {
+    memcpy(dx, p, len);
+    parity_syndromes(data, n, len, present, dx, NULL);
+    return true;
+  }
+
+  if (m == 1) {
+    memcpy(dx, q, len);
+    parity_syndromes(data, n, len, present, NULL, dx);
+    uint8_t inv = gf_div(1, gf_exp[x]);
+    for (size_t k = 0; k < len; k++) dx[k] = gf_mul(dx[k], inv);
+    return true;
+  }
+
+  int y = missing[1];
+  uint8_t *dy = data[y];
+  memcpy(dy, p, len);
+  memcpy(dx, q, len);
+  parity_syndromes(data, n, len, present, dy, dx);
+
+  uint8_t gy = gf_exp[y];
+  uint8_t denom = gf_exp[x] ^ gy;
+  for (size_t k = 0; k < len; k++) {
+    uint8_t pxy = dy[k];
+    uint8_t v = gf_div(dx[k] ^ gf_mul(gy, pxy), denom);
+    dx[k] = v;
+    dy[k] = pxy ^ v;
+  }
+  return true;
+}
@@ -0,0 +1,15 @@
+#ifndef PARITY_H
+#define PARITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PARITY_MAX_SHARDS 2
+#define PARITY_MAX_DATA 255
+
+void parity_encode(const uint8_t *const data[], int n, size_t len, uint8_t *p, uint8_t *q);
+bool parity_rebuild(uint8_t *const data[], int n, size_t len, const bool present[],
+                    const uint8_t *p, const uint8_t *q);
+
+#endif
@@ -0,0 +1,356 @@
+#include "drive_emu_sim.h"
+#include "hardware/pio.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "flux_read.pio.h"
+#include "flux_write.pio.h"
+#include <string.h>
+
+static drive_emu_sim_t *g_sim = NULL;
+
+void drive_emu_sim_init(drive_emu_sim_t *sim, drive_emu_t *emu, const drive_emu_sim_cost_t *cost) {
+    memset(sim, 0, sizeof(*sim));
+    sim->emu = emu;
+    sim->cost = *cost;
+    for (int i = 0; i < DRIVE_EMU_SIM_PINS; i++) {
+        sim->level[i] = true;
+        sim->value[i] = true;
+    }
+
+    pio_emu_init(&sim->out_emu);
+    pio_emu_load(&sim->out_emu, pio_emu_flux_write_prog, FLUX_WRITE_LEN,
+                 FLUX_WRITE_WRAP_TARGET, FLUX_WRITE_WRAP);
+    sim->out_emu.out_shift_right = true;
+    sim->out_emu.autopull_threshold = 8;
+    sim->out_emu.set_pins = 1;
+
+    pio_emu_init(&sim->cap_emu);
+    pio_emu_load(&sim->cap_emu, pio_emu_flux_read_prog, FLUX_READ_LEN,
+                 FLUX_READ_WRAP_TARGET, FLUX_READ_WRAP);
+    sim->cap_emu.in_shift_right = true;
+    sim->cap_emu.autopush_threshold = 32;
+    sim->cap_emu.jmp_pin = true;
+    sim->cap_emu.pin_values = 1;
+
+    mfm_init(&sim->host_mfm);
+    sim->rd_prev = true;
+    sim->index_prev = true;
+    sim->out_stalled = true;
+    g_sim = sim;
+}
+
+void drive_emu_sim_set(drive_emu_sim_t *sim, uint8_t pin, bool level) {
+    if (sim->level[pin] && !level) sim->irq_events[pin] |= GPIO_IRQ_EDGE_FALL;
+    if (!sim->level[pin] && level) sim->irq_events[pin] |= GPIO_IRQ_EDGE_RISE;
+    sim->level[pin] = level;
+}
+
+bool drive_emu_sim_output(drive_emu_sim_t *sim, uint8_t pin) {
+    return !(sim->dir_out[pin] && !sim->value[pin]);
+}
+
+static void sim_host_sector(drive_emu_sim_t *sim) {
+    sector_t *s = &sim->host_sector;
+    if (!s->valid) {
+        sim->crc_errors++;
+        return;
+    }
+    if (s->sector_n < 1 || s->sector_n > SECTORS_PER_TRACK) return;
+    sim->seen[s->sector_n - 1] = *s;
+    sim->sectors_decoded++;
+}
+
+static void sim_write_begin(drive_emu_sim_t *sim) {
+    sim->wr_arm_sector = 0;
+    sim->wr_active = true;
+    sim->wr_pos = 0;
+    sim->wr_flux_left = 0;
+    sim->wr_pulse_left = 0;
+    sim->level[sim->emu->pins.write_gate] = false;
+}
+
+static void sim_read_edge(drive_emu_sim_t *sim) {
+    uint64_t t = sim->out_emu.cycle_count;
+    if (sim->rd_have_edge) {
+        uint64_t d = t - sim->rd_last_edge;
+        if (mfm_feed(&sim->host_mfm, d > 0xFFFF ? 0xFFFF : (uint16_t)d, &sim->host_sector)) {
+            sim_host_sector(sim);
+        }
+        if (sim->wr_arm_sector > 0 && sim->host_mfm.have_pending_addr &&
+            sim->host_mfm.pending_sector == sim->wr_arm_sector) {
+            sim_write_begin(sim);
+        }
+    }
+    sim->rd_last_edge = t;
+    sim->rd_have_edge = true;
+}
+
+static void sim_step_out(drive_emu_sim_t *sim) {
+    pio_emu_t *emu = &sim->out_emu;
+    pio_emu_step(emu);
+
+    bool rd = !sim->out_pindir || (emu->set_pins & 1);
+    if (sim->rd_prev && !rd) sim_read_edge(sim);
+    sim->rd_prev = rd;
+
+    if (emu->stalled && !sim->out_stalled && sim->emu->motor_on) {
+        sim->underruns++;
+    }
+    sim->out_stalled = emu->stalled;
+}
+
+static void sim_step_write_data(drive_emu_sim_t *sim) {
+    pio_emu_t *emu = &sim->cap_emu;
+    if (sim->wr_pulse_left > 0 && --sim->wr_pulse_left == 0) {
+        emu->jmp_pin = true;
+    }
+    if (sim->wr_flux_left == 0 || --sim->wr_flux_left == 0) {
+        if (sim->wr_pos > 0) {
+            emu->jmp_pin = false;
+            sim->wr_pulse_left = DRIVE_EMU_SIM_PULSE_TICKS;
+        }
+        if (sim->wr_pos < sim->wr_len) {
+            uint32_t v = sim->wr_pulses[sim->wr_pos++] + MFM_PIO_OVERHEAD;
+            sim->wr_flux_left = v * DRIVE_EMU_SIM_OUT_DIV;
+        } else {
+            sim->wr_active = false;
+            sim->level[sim->emu->pins.write_gate] = true;
+            emu->jmp_pin = true;
+        }
+    }
+}
+
+static void sim_tick(drive_emu_sim_t *sim) {
+    sim->now++;
+    if (sim->pulse_armed) {
+        if (sim->now == sim->pulse_fall) drive_emu_sim_set(sim, sim->pulse_pin, false);
+        if (sim->now == sim->pulse_rise) {
+            drive_emu_sim_set(sim, sim->pulse_pin, true);
+            sim->pulse_armed = false;
+        }
+    }
+    if (sim->wr_active) sim_step_write_data(sim);
+    if (sim->cap_enabled) pio_emu_step(&sim->cap_emu);
+    if (++sim->out_phase == DRIVE_EMU_SIM_OUT_DIV) {
+        sim->out_phase = 0;
+        if (sim->out_enabled) sim_step_out(sim);
+    }
+}
+
+static void sim_advance(drive_emu_sim_t *sim, uint64_t ticks) {
+    for (uint64_t i = 0; i < ticks; i++) sim_tick(sim);
+}
+
+static void sim_check_index(drive_emu_sim_t *sim) {
+    bool idx = drive_emu_sim_output(sim, sim->emu->pins.index);
+    if (sim->index_prev && !idx) {
+        sim->index_times[sim->index_count % DRIVE_EMU_SIM_MAX_INDEX] = sim->now;
+        sim->index_count++;
+        if (sim->wr_arm_sector < 0) sim_write_begin(sim);
+    }
+    sim->index_prev = idx;
+}
+
+static void sim_charge(drive_emu_sim_t *sim, uint32_t cycles) {
+    cycles += (sim->emu->stats.encoded - sim->charged) * sim->cost.encode_value_cycles;
+    sim->charged = sim->emu->stats.encoded;
+    uint64_t t = (uint64_t)cycles * DRIVE_EMU_SIM_TICK_HZ / clock_get_hz(clk_sys);
+    sim_advance(sim, t ? t : 1);
+}
+
+void drive_emu_sim_run(drive_emu_sim_t *sim, uint64_t ticks) {
+    uint64_t end = sim->now + ticks;
+    while (sim->now < end) {
+        sim->charged = sim->emu->stats.encoded;
+        drive_emu_poll(sim->emu);
+        sim_check_index(sim);
+        sim_charge(sim, sim->cost.poll_cycles);
+    }
+}
+
+void drive_emu_sim_run_ms(drive_emu_sim_t *sim, uint32_t ms) {
+    drive_emu_sim_run(sim, (uint64_t)ms * (DRIVE_EMU_SIM_TICK_HZ / 1000));
+}
+
+void drive_emu_sim_pulse(drive_emu_sim_t *sim, uint8_t pin, uint64_t delay, uint64_t width) {
+    sim->pulse_pin = pin;
+    sim->pulse_fall = sim->now + (delay ? delay : 1);
+    sim->pulse_rise = sim->pulse_fall + (width ? width : 1);
+    sim->pulse_armed = true;
+}
+
+void drive_emu_sim_step(drive_emu_sim_t *sim, bool inward, int count) {
+    drive_emu_sim_set(sim, sim->emu->pins.direction, !inward);
+    drive_emu_sim_run(sim, DRIVE_EMU_SIM_TICK_HZ / 1000000);
+    for (int i = 0; i < count; i++) {
+        drive_emu_sim_pulse(sim, sim->emu->pins.step, 1, DRIVE_EMU_SIM_TICK_HZ / 1000000);
+        drive_emu_sim_run_ms(sim, 3);
+    }
+}
+
+void drive_emu_sim_clear_seen(drive_emu_sim_t *sim) {
+    memset(sim->seen, 0, sizeof(sim->seen));
+    sim->sectors_decoded = 0;
+    sim->crc_errors = 0;
+}
+
+int drive_emu_sim_seen_count(drive_emu_sim_t *sim, uint8_t track, uint8_t side) {
+    int n = 0;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (sim->seen[i].valid && sim->seen[i].track == track && sim->seen[i].side == side) n++;
+    }
+    return n;
+}
+
+void drive_emu_sim_write(drive_emu_sim_t *sim, const uint8_t *pulses, size_t len, int arm_sector) {
+    sim->wr_pulses = pulses;
+    sim->wr_len = len;
+    sim->wr_arm_sector = arm_sector;
+    if (arm_sector == 0) sim_write_begin(sim);
+}
+
+void gpio_init(uint pin) { (void)pin; }
+void gpio_pull_up(uint pin) { (void)pin; }
+
+void gpio_set_dir(uint pin, bool out) {
+    if (g_sim && pin < DRIVE_EMU_SIM_PINS) g_sim->dir_out[pin] = out;
+}
+
+void gpio_put(uint pin, bool value) {
+    if (g_sim && pin < DRIVE_EMU_SIM_PINS) g_sim->value[pin] = value;
+}
+
+bool gpio_get(uint pin) {
+    if (!g_sim || pin >= DRIVE_EMU_SIM_PINS) return true;
+    if (!g_sim->level[pin]) g_sim->low_reads[pin]++;
+    return g_sim->level[pin];
+}
+
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled) {
+    if (!g_sim || pin >= DRIVE_EMU_SIM_PINS) return;
+    if (enabled) {
+        g_sim->irq_enabled[pin] |= events;
+    } else {
+        g_sim->irq_enabled[pin] &= ~events;
+    }
+}
+
+uint32_t gpio_get_irq_event_mask(uint pin) {
+    if (!g_sim || pin >= DRIVE_EMU_SIM_PINS) return 0;
+    return g_sim->irq_events[pin] & g_sim->irq_enabled[pin];
+}
+
+void gpio_acknowledge_irq(uint pin, uint32_t events) {
+    if (g_sim && pin < DRIVE_EMU_SIM_PINS) g_sim->irq_events[pin] &= ~events;
+}
+
+static pio_emu_t *sim_emu(PIO pio) {
+    return pio->id == 0 ? &g_sim->out_emu : &g_sim->cap_emu;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    (void)pio; (void)program;
+    return 0;
+}
+
+uint pio_claim_unused_sm(PIO pio, bool required) {
+    (void)pio; (void)required;
+    return 0;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint offset, const pio_sm_config *config) {
+    (void)pio; (void)sm; (void)offset; (void)config;
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    (void)sm;
+    if (pio->id == 0) {
+        g_sim->out_emu.pc = instr;
+    } else {
+        g_sim->cap_emu.x = instr;
+    }
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    (void)sm;
+    pio_emu_t *emu = sim_emu(pio);
+    emu->isr = 0;
+    emu->isr_shift_count = 0;
+    emu->osr_shift_count = 32;
+    emu->delay_remaining = 0;
+    emu->stalled = false;
+    emu->pc = 0;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    (void)sm;
+    pio_emu_t *emu = sim_emu(pio);
+    emu->rx_head = emu->rx_count = 0;
+    emu->tx_head = emu->tx_count = 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    (void)sm;
+    if (pio->id == 0) {
+        g_sim->out_enabled = enabled;
+    } else {
+        g_sim->cap_enabled = enabled;
+    }
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t values, uint32_t mask) {
+    (void)pio; (void)sm; (void)values; (void)mask;
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin, uint count, bool is_out) {
+    (void)sm; (void)pin; (void)count;
+    if (pio->id == 0) g_sim->out_pindir = is_out;
+}
+
+void pio_gpio_init(PIO pio, uint pin) { (void)pio; (void)pin; }
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    (void)sm;
+    return pio_emu_rx_empty(sim_emu(pio));
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm) {
+    (void)sm;
+    return sim_emu(pio)->tx_count == 0;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm) {
+    (void)sm;
+    if (g_sim->emu->stats.encoded != g_sim->charged) sim_charge(g_sim, 0);
+    return pio_emu_tx_full(sim_emu(pio));
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
+    (void)sm;
+    pio_emu_t *emu = sim_emu(pio);
+    while (pio_emu_rx_empty(emu)) sim_tick(g_sim);
+    return pio_emu_rx_get(emu);
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    (void)sm;
+    pio_emu_t *emu = sim_emu(pio);
+    while (pio_emu_tx_full(emu)) sim_tick(g_sim);
+    pio_emu_tx_put(emu, data);
+}
+
+static pio_hw_t pio0_hw = { .id = 0 };
+static pio_hw_t pio1_hw = { .id = 1 };
+PIO pio0 = &pio0_hw;
+PIO pio1 = &pio1_hw;
+
+const pio_program_t flux_read_program = {0};
+const pio_program_t flux_write_program = {0};
+
+void flux_read_program_init(PIO pio, uint sm, uint offset, uint pin, uint index_pin) {
+    (void)pio; (void)sm; (void)offset; (void)pin; (void)index_pin;
+}
+
+void flux_write_program_init(PIO pio, uint sm, uint offset, uint pin) {
+    (void)pio; (void)sm; (void)offset; (void)pin;
+}
@@ -0,0 +1,82 @@
+#ifndef DRIVE_EMU_SIM_H
+#define DRIVE_EMU_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pio_emu.h"
+#include "../src/drive_emu.h"
+#include "../src/mfm_decode.h"
+
+#define DRIVE_EMU_SIM_PINS 32
+#define DRIVE_EMU_SIM_TICK_HZ 72000000
+#define DRIVE_EMU_SIM_OUT_DIV 3
+#define DRIVE_EMU_SIM_PULSE_TICKS 12
+#define DRIVE_EMU_SIM_MAX_INDEX 32
+
+typedef struct {
+    uint32_t poll_cycles;
+    uint32_t encode_value_cycles;
+} drive_emu_sim_cost_t;
+
+typedef struct {
+    pio_emu_t out_emu;
+    pio_emu_t cap_emu;
+    bool out_enabled;
+    bool cap_enabled;
+    bool out_pindir;
+    uint8_t out_phase;
+    uint64_t now;
+
+    drive_emu_t *emu;
+    drive_emu_sim_cost_t cost;
+    uint32_t charged;
+
+    bool level[DRIVE_EMU_SIM_PINS];
+    bool dir_out[DRIVE_EMU_SIM_PINS];
+    bool value[DRIVE_EMU_SIM_PINS];
+    uint32_t irq_enabled[DRIVE_EMU_SIM_PINS];
+    uint32_t irq_events[DRIVE_EMU_SIM_PINS];
+    uint32_t low_reads[DRIVE_EMU_SIM_PINS];
+
+    bool pulse_armed;
+    uint8_t pulse_pin;
+    uint64_t pulse_fall;
+    uint64_t pulse_rise;
+
+    bool rd_prev;
+    bool rd_have_edge;
+    uint64_t rd_last_edge;
+    mfm_t host_mfm;
+    sector_t host_sector;
+    sector_t seen[SECTORS_PER_TRACK];
+    uint32_t sectors_decoded;
+    uint32_t crc_errors;
+
+    bool index_prev;
+    uint64_t index_times[DRIVE_EMU_SIM_MAX_INDEX];
+    uint32_t index_count;
+
+    bool out_stalled;
+    uint32_t underruns;
+
+    const uint8_t *wr_pulses;
+    size_t wr_len;
+    size_t wr_pos;
+    uint32_t wr_flux_left;
+    uint32_t wr_pulse_left;
+    bool wr_active;
+    int wr_arm_sector;
+} drive_emu_sim_t;
+
+void drive_emu_sim_init(drive_emu_sim_t *sim, drive_emu_t *emu, const drive_emu_sim_cost_t *cost);
+void drive_emu_sim_set(drive_emu_sim_t *sim, uint8_t pin, bool level);
+bool drive_emu_sim_output(drive_emu_sim_t *sim, uint8_t pin);
+void drive_emu_sim_run(drive_emu_sim_t *sim, uint64_t ticks);
+void drive_emu_sim_run_ms(drive_emu_sim_t *sim, uint32_t ms);
+void drive_emu_sim_pulse(drive_emu_sim_t *sim, uint8_t pin, uint64_t delay, uint64_t width);
+void drive_emu_sim_step(drive_emu_sim_t *sim, bool inward, int count);
+void drive_emu_sim_clear_seen(drive_emu_sim_t *sim);
+int drive_emu_sim_seen_count(drive_emu_sim_t *sim, uint8_t track, uint8_t side);
+void drive_emu_sim_write(drive_emu_sim_t *sim, const uint8_t *pulses, size_t len, int arm_sector);
+
+#endif
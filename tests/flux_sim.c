@@ -81,6 +81,7 @@ bool flux_sim_seek(flux_sim_t *sim, uint8_t track, uint8_t side, uint8_t rev) {
 
     sim->rev.count = out_pos;
     sim->rev.pos = 0;
+    sim->shift_carry = 0;
     return true;
 }
 
@@ -89,6 +90,22 @@ bool flux_sim_next(flux_sim_t *sim, uint16_t *delta) {
 
     int32_t d = sim->rev.deltas[sim->rev.pos++];
 
+    if (sim->peak_shift != 0) {
+        d += sim->shift_carry;
+        sim->shift_carry = 0;
+        if (sim->rev.pos < sim->rev.count) {
+            int32_t raw = sim->rev.deltas[sim->rev.pos - 1];
+            int32_t next = sim->rev.deltas[sim->rev.pos];
+            if (next > raw + raw / 4) {
+                d += sim->peak_shift;
+                sim->shift_carry = -sim->peak_shift;
+            } else if (raw > next + next / 4) {
+                d -= sim->peak_shift;
+                sim->shift_carry = sim->peak_shift;
+            }
+        }
+    }
+
     if (sim->drift_ppm != 0) {
         d = (d * (1000000 + sim->drift_ppm)) / 1000000;
     }
@@ -116,6 +133,11 @@ void flux_sim_set_drift(flux_sim_t *sim, int32_t ppm) {
     sim->drift_ppm = ppm;
 }
 
+void flux_sim_set_peak_shift(flux_sim_t *sim, int16_t counts) {
+    sim->peak_shift = counts;
+    sim->shift_carry = 0;
+}
+
 bool flux_sim_from_track(flux_sim_t *sim, const uint8_t *pulse_buf, size_t pulse_count) {
     memset(sim, 0, sizeof(*sim));
     flux_rev_ensure(&sim->rev, pulse_count);
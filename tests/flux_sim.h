@@ -26,6 +26,8 @@ typedef struct {
     uint32_t jitter_seed;
     int16_t jitter_range;
     int32_t drift_ppm;
+    int16_t peak_shift;
+    int16_t shift_carry;
 } flux_sim_t;
 
 bool flux_sim_open_scp(flux_sim_t *sim, uint8_t *data, size_t size);
@@ -35,6 +37,7 @@ void flux_sim_close(flux_sim_t *sim);
 
 void flux_sim_set_jitter(flux_sim_t *sim, int16_t range, uint32_t seed);
 void flux_sim_set_drift(flux_sim_t *sim, int32_t ppm);
+void flux_sim_set_peak_shift(flux_sim_t *sim, int16_t counts);
 
 bool flux_sim_from_track(flux_sim_t *sim, const uint8_t *pulse_buf, size_t pulse_count);
 
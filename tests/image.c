@@ -0,0 +1,715 @@
+#include "image.h"
+#include "../src/crc.h"
+#include "../src/mfm_decode.h"
+#include "../src/mfm_encode.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IMG_TRACK_BYTES (SECTORS_PER_TRACK * SECTOR_SIZE)
+
+#define IMD_MODE_MFM_500K 3
+#define IMD_CYL_MAP 0x80
+#define IMD_HEAD_MAP 0x40
+
+#define HFE_BLOCK 512
+#define HFE_CHUNK 256
+#define HFE_CELL_COUNTS 24
+#define HFE_TRACK_BLOCKS ((IMAGE_HFE_TRACK_BYTES * 2 + HFE_BLOCK - 1) / HFE_BLOCK)
+#define HFE_TRACK_CELLS (IMAGE_HFE_TRACK_BYTES * 8)
+
+#define SCP_TABLE_ENTRIES 168
+#define SCP_HEADER_SIZE 16
+#define SCP_DATA_START (SCP_HEADER_SIZE + SCP_TABLE_ENTRIES * 4)
+
+#define SECTOR_RAW_BYTES (15 + 7 + 22 + 15 + 1 + SECTOR_SIZE + 2)
+
+static uint32_t read_le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_le16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void write_le32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void write_le16(uint8_t *p, uint16_t v) {
+    p[0] = v; p[1] = v >> 8;
+}
+
+static bool read_at(int fd, long off, void *buf, size_t len) {
+    return pread(fd, buf, len, off) == (ssize_t)len;
+}
+
+image_format_t image_format_from_path(const char *path) {
+    const char *dot = strrchr(path, '.');
+    if (!dot) return IMAGE_UNKNOWN;
+    if (strcasecmp(dot, ".img") == 0 || strcasecmp(dot, ".ima") == 0) return IMAGE_IMG;
+    if (strcasecmp(dot, ".imd") == 0) return IMAGE_IMD;
+    if (strcasecmp(dot, ".hfe") == 0) return IMAGE_HFE;
+    if (strcasecmp(dot, ".scp") == 0) return IMAGE_SCP;
+    return IMAGE_UNKNOWN;
+}
+
+const char *image_format_name(image_format_t format) {
+    switch (format) {
+        case IMAGE_IMG: return "IMG";
+        case IMAGE_IMD: return "IMD";
+        case IMAGE_HFE: return "HFE";
+        case IMAGE_SCP: return "SCP";
+        default: return "unknown";
+    }
+}
+
+void image_track_init(image_track_t *t, uint8_t track, uint8_t side) {
+    memset(t, 0, sizeof(*t));
+    t->track.track = track;
+    t->track.side = side;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        t->track.sectors[i].track = track;
+        t->track.sectors[i].side = side;
+        t->track.sectors[i].sector_n = i + 1;
+        t->track.sectors[i].size_code = 2;
+        t->status[i] = IMAGE_SECTOR_MISSING;
+    }
+}
+
+static void image_set_sector(image_track_t *t, int idx, image_status_t status, const uint8_t *data) {
+    t->status[idx] = status;
+    t->track.sectors[idx].valid = (status == IMAGE_SECTOR_OK || status == IMAGE_SECTOR_DELETED);
+    if (data) {
+        memcpy(t->track.sectors[idx].data, data, SECTOR_SIZE);
+    } else {
+        memset(t->track.sectors[idx].data, 0, SECTOR_SIZE);
+    }
+}
+
+static bool image_track_complete(const image_track_t *t) {
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (!t->track.sectors[i].valid) return false;
+    }
+    return true;
+}
+
+size_t image_encode_track(const image_track_t *t, uint8_t *pulses, size_t size) {
+    mfm_encode_t e;
+    mfm_encode_init(&e, pulses, size);
+
+    bool plain = true;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (t->status[i] != IMAGE_SECTOR_OK) plain = false;
+    }
+    if (plain) return mfm_encode_track(&e, &t->track);
+
+    mfm_encode_gap(&e, 80);
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        const sector_t *s = &t->track.sectors[i];
+        if (t->status[i] == IMAGE_SECTOR_MISSING) {
+            mfm_encode_gap(&e, SECTOR_RAW_BYTES + 54);
+            continue;
+        }
+
+        uint8_t addr[5] = {MFM_ADDR_MARK, s->track, s->side, s->sector_n, 0x02};
+        uint16_t addr_crc = crc16_mfm(addr, 5);
+        uint8_t addr_crc_bytes[2] = {addr_crc >> 8, addr_crc & 0xFF};
+        mfm_encode_sync(&e);
+        mfm_encode_bytes(&e, addr, 5);
+        mfm_encode_bytes(&e, addr_crc_bytes, 2);
+        mfm_encode_gap(&e, 22);
+
+        uint8_t mark = t->status[i] == IMAGE_SECTOR_DELETED ? MFM_DELETED_MARK : MFM_DATA_MARK;
+        uint16_t data_crc = crc16(s->data, SECTOR_SIZE, crc16_mfm(&mark, 1));
+        if (t->status[i] == IMAGE_SECTOR_BAD_CRC) data_crc ^= 0xFFFF;
+        uint8_t data_crc_bytes[2] = {data_crc >> 8, data_crc & 0xFF};
+        mfm_encode_sync(&e);
+        mfm_encode_bytes(&e, &mark, 1);
+        mfm_encode_bytes(&e, s->data, SECTOR_SIZE);
+        mfm_encode_bytes(&e, data_crc_bytes, 2);
+
+        mfm_encode_gap(&e, 54);
+    }
+    return e.pos;
+}
+
+void image_decode_flux(const uint16_t *deltas, uint32_t count, image_track_t *t) {
+    mfm_t mfm;
+    mfm_init(&mfm);
+    sector_t out;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!mfm_feed(&mfm, deltas[i], &out)) continue;
+        if (out.track != t->track.track || out.side != t->track.side) continue;
+        if (out.sector_n < 1 || out.sector_n > SECTORS_PER_TRACK || out.size_code != 2) continue;
+
+        int idx = out.sector_n - 1;
+        if (out.valid) {
+            if (!t->track.sectors[idx].valid) {
+                image_set_sector(t, idx, mfm.data_mark == MFM_DELETED_MARK ?
+                                 IMAGE_SECTOR_DELETED : IMAGE_SECTOR_OK, out.data);
+            }
+        } else if (t->status[idx] == IMAGE_SECTOR_MISSING) {
+            image_set_sector(t, idx, IMAGE_SECTOR_BAD_CRC, out.data);
+        }
+    }
+}
+
+static size_t hfe_pulses_to_bits(const uint8_t *pulses, size_t n, uint8_t *bits) {
+    size_t cell = 0;
+    memset(bits, 0, IMAGE_HFE_TRACK_BYTES);
+    for (size_t i = 0; i < n && cell < HFE_TRACK_CELLS; i++) {
+        size_t cells = (pulses[i] + MFM_PIO_OVERHEAD + HFE_CELL_COUNTS / 2) / HFE_CELL_COUNTS;
+        cell += cells - 1;
+        if (cell >= HFE_TRACK_CELLS) break;
+        bits[cell / 8] |= 1 << (cell % 8);
+        cell++;
+    }
+    return cell;
+}
+
+static uint32_t hfe_bits_to_deltas(const uint8_t *bits, size_t nbytes, uint16_t *deltas) {
+    uint32_t n = 0;
+    uint32_t cells = 0;
+    for (size_t i = 0; i < nbytes * 8; i++) {
+        cells++;
+        if (bits[i / 8] & (1 << (i % 8))) {
+            uint32_t d = cells * HFE_CELL_COUNTS;
+            deltas[n++] = d > 0xFFFF ? 0xFFFF : d;
+            cells = 0;
+        }
+    }
+    return n;
+}
+
+static bool img_read_track(image_reader_t *r, uint8_t track, uint8_t side, image_track_t *out) {
+    uint8_t buf[IMG_TRACK_BYTES];
+    long off = (long)(track * IMAGE_SIDES + side) * IMG_TRACK_BYTES;
+    if (!read_at(r->fd, off, buf, sizeof(buf))) return true;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        image_set_sector(out, i, IMAGE_SECTOR_OK, buf + i * SECTOR_SIZE);
+    }
+    return true;
+}
+
+static bool imd_open(image_reader_t *r) {
+    uint8_t buf[256];
+    long pos = 0;
+    bool found = false;
+
+    if (!read_at(r->fd, 0, buf, 4) || memcmp(buf, "IMD ", 4) != 0) return false;
+    while (!found) {
+        ssize_t n = pread(r->fd, buf, sizeof(buf), pos);
+        if (n <= 0) return false;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == 0x1A) {
+                pos += i + 1;
+                found = true;
+                break;
+            }
+        }
+        if (!found) pos += n;
+    }
+
+    uint8_t hdr[5];
+    while (read_at(r->fd, pos, hdr, 5)) {
+        if (hdr[0] != IMD_MODE_MFM_500K) return false;
+        uint8_t cyl = hdr[1];
+        uint8_t head = hdr[2];
+        uint8_t nsec = hdr[3];
+        uint8_t size = hdr[4];
+        long start = pos;
+
+        pos += 5 + nsec;
+        if (head & IMD_CYL_MAP) pos += nsec;
+        if (head & IMD_HEAD_MAP) pos += nsec;
+        if (size == 0xFF) pos += nsec * 2;
+        if (size > 6 && size != 0xFF) return false;
+
+        for (int i = 0; i < nsec; i++) {
+            uint8_t type;
+            if (!read_at(r->fd, pos, &type, 1)) return false;
+            pos++;
+            if (type == 0) continue;
+            if (type > 8) return false;
+            if (type & 1) {
+                if (size == 0xFF) return false;
+                pos += 128 << size;
+            } else {
+                pos++;
+            }
+        }
+
+        if (cyl < FLOPPY_TRACKS) {
+            r->offsets[cyl * IMAGE_SIDES + (head & 1)] = start;
+        }
+    }
+    return true;
+}
+
+static bool imd_read_track(image_reader_t *r, image_track_t *out) {
+    long pos = r->offsets[out->track.track * IMAGE_SIDES + out->track.side];
+    if (pos == 0) return true;
+
+    uint8_t hdr[5];
+    if (!read_at(r->fd, pos, hdr, 5)) return false;
+    uint8_t head = hdr[2];
+    uint8_t nsec = hdr[3];
+    uint8_t size = hdr[4];
+    if (size > 6) return true;
+    pos += 5;
+
+    uint8_t map[256];
+    if (!read_at(r->fd, pos, map, nsec)) return false;
+    pos += nsec;
+    if (head & IMD_CYL_MAP) pos += nsec;
+    if (head & IMD_HEAD_MAP) pos += nsec;
+
+    uint8_t data[SECTOR_SIZE];
+    for (int i = 0; i < nsec; i++) {
+        uint8_t type;
+        if (!read_at(r->fd, pos, &type, 1)) return false;
+        pos++;
+        if (type == 0) continue;
+
+        uint16_t len = 128 << size;
+        bool compressed = !(type & 1);
+        if (compressed) {
+            uint8_t fill;
+            if (!read_at(r->fd, pos, &fill, 1)) return false;
+            memset(data, fill, sizeof(data));
+            pos++;
+        } else {
+            if (len == SECTOR_SIZE && !read_at(r->fd, pos, data, len)) return false;
+            pos += len;
+        }
+
+        if (size != 2 || map[i] < 1 || map[i] > SECTORS_PER_TRACK) continue;
+
+        image_status_t status = IMAGE_SECTOR_OK;
+        if (type >= 5) status = IMAGE_SECTOR_BAD_CRC;
+        else if (type >= 3) status = IMAGE_SECTOR_DELETED;
+        image_set_sector(out, map[i] - 1, status, data);
+    }
+    return true;
+}
+
+static bool hfe_open(image_reader_t *r) {
+    uint8_t hdr[HFE_BLOCK];
+    if (!read_at(r->fd, 0, hdr, sizeof(hdr))) return false;
+    if (memcmp(hdr, "HXCPICFE", 8) != 0 || hdr[8] != 0) return false;
+
+    uint8_t tracks = hdr[9];
+    uint8_t sides = hdr[10];
+    uint16_t list = read_le16(hdr + 18);
+    if (tracks > FLOPPY_TRACKS) tracks = FLOPPY_TRACKS;
+
+    uint8_t entries[FLOPPY_TRACKS * 4];
+    if (!read_at(r->fd, (long)list * HFE_BLOCK, entries, tracks * 4)) return false;
+    for (int t = 0; t < tracks; t++) {
+        long off = (long)read_le16(entries + t * 4) * HFE_BLOCK;
+        r->hfe_lengths[t] = read_le16(entries + t * 4 + 2);
+        for (int s = 0; s < sides && s < IMAGE_SIDES; s++) {
+            r->offsets[t * IMAGE_SIDES + s] = off;
+        }
+    }
+    return true;
+}
+
+static bool hfe_read_track(image_reader_t *r, image_track_t *out) {
+    long off = r->offsets[out->track.track * IMAGE_SIDES + out->track.side];
+    if (off == 0) return true;
+
+    uint8_t bits[IMAGE_HFE_TRACK_BYTES];
+    size_t want = r->hfe_lengths[out->track.track] / 2;
+    if (want > sizeof(bits)) want = sizeof(bits);
+    size_t got = 0;
+    for (int c = 0; got < want; c++) {
+        size_t len = want - got;
+        if (len > HFE_CHUNK) len = HFE_CHUNK;
+        long pos = off + (long)c * HFE_BLOCK + out->track.side * HFE_CHUNK;
+        if (!read_at(r->fd, pos, bits + got, len)) break;
+        got += len;
+    }
+    if (got == 0) return true;
+
+    uint16_t *deltas = malloc(got * 8 * sizeof(uint16_t));
+    if (!deltas) return false;
+    uint32_t n = hfe_bits_to_deltas(bits, got, deltas);
+    image_decode_flux(deltas, n, out);
+    free(deltas);
+    return true;
+}
+
+static bool scp_open(image_reader_t *r) {
+    uint8_t hdr[SCP_HEADER_SIZE];
+    if (!read_at(r->fd, 0, hdr, sizeof(hdr))) return false;
+    if (hdr[0] != 'S' || hdr[1] != 'C' || hdr[2] != 'P') return false;
+
+    r->scp_revs = hdr[5] > IMAGE_SCP_MAX_REVS ? IMAGE_SCP_MAX_REVS : hdr[5];
+    r->scp_resolution = hdr[9];
+
+    uint8_t table[IMAGE_TRACK_COUNT * 4];
+    if (!read_at(r->fd, SCP_HEADER_SIZE, table, sizeof(table))) return false;
+    for (int i = 0; i < IMAGE_TRACK_COUNT; i++) {
+        r->offsets[i] = read_le32(table + i * 4);
+    }
+    return true;
+}
+
+static bool scp_read_track(image_reader_t *r, image_track_t *out) {
+    int idx = out->track.track * IMAGE_SIDES + out->track.side;
+    long tdh = r->offsets[idx];
+    if (tdh == 0) return true;
+
+    uint8_t head[4 + IMAGE_SCP_MAX_REVS * 12];
+    if (!read_at(r->fd, tdh, head, 4 + r->scp_revs * 12)) return false;
+    if (head[0] != 'T' || head[1] != 'R' || head[2] != 'K') return false;
+
+    uint32_t scale_num = (r->scp_resolution + 1) * 3;
+    for (int rev = 0; rev < r->scp_revs && !image_track_complete(out); rev++) {
+        uint32_t count = read_le32(head + 4 + rev * 12 + 4);
+        uint32_t data_off = read_le32(head + 4 + rev * 12 + 8);
+
+        uint8_t *raw = malloc(count * 2);
+        uint16_t *deltas = malloc(count * sizeof(uint16_t));
+        if (!raw || !deltas || !read_at(r->fd, tdh + data_off, raw, count * 2)) {
+            free(raw);
+            free(deltas);
+            return false;
+        }
+
+        uint32_t n = 0;
+        uint32_t acc = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint16_t val = (raw[i * 2] << 8) | raw[i * 2 + 1];
+            if (val == 0) { acc += 65536; continue; }
+            uint32_t d = ((acc + val) * scale_num + 2) / 5;
+            acc = 0;
+            deltas[n++] = d > 0xFFFF ? 0xFFFF : d;
+        }
+
+        image_decode_flux(deltas, n, out);
+        free(raw);
+        free(deltas);
+    }
+    return true;
+}
+
+bool image_reader_open(image_reader_t *r, const char *path, image_format_t format) {
+    memset(r, 0, sizeof(*r));
+    r->format = format;
+    r->fd = open(path, O_RDONLY);
+    if (r->fd < 0) return false;
+
+    bool ok = true;
+    switch (format) {
+        case IMAGE_IMG: break;
+        case IMAGE_IMD: ok = imd_open(r); break;
+        case IMAGE_HFE: ok = hfe_open(r); break;
+        case IMAGE_SCP: ok = scp_open(r); break;
+        default: ok = false; break;
+    }
+    if (!ok) {
+        close(r->fd);
+        r->fd = -1;
+    }
+    return ok;
+}
+
+bool image_read_track(image_reader_t *r, uint8_t track, uint8_t side, image_track_t *out) {
+    image_track_init(out, track, side);
+    switch (r->format) {
+        case IMAGE_IMG: return img_read_track(r, track, side, out);
+        case IMAGE_IMD: return imd_read_track(r, out);
+        case IMAGE_HFE: return hfe_read_track(r, out);
+        case IMAGE_SCP: return scp_read_track(r, out);
+        default: return false;
+    }
+}
+
+void image_reader_close(image_reader_t *r) {
+    if (r->fd >= 0) close(r->fd);
+    r->fd = -1;
+}
+
+static bool imd_write_header(image_writer_t *w) {
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%d/%m/%Y %H:%M:%S", localtime(&now));
+    fprintf(w->fp, "IMD 1.18: %s\r\npico-mfm-floppy\r\n", stamp);
+    return fputc(0x1A, w->fp) != EOF;
+}
+
+static bool imd_write_track(image_writer_t *w, const image_track_t *t) {
+    uint8_t nsec = 0;
+    uint8_t map[SECTORS_PER_TRACK];
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (t->status[i] != IMAGE_SECTOR_MISSING) map[nsec++] = i + 1;
+    }
+
+    uint8_t hdr[5] = {IMD_MODE_MFM_500K, t->track.track, t->track.side, nsec, 2};
+    fwrite(hdr, 1, 5, w->fp);
+    fwrite(map, 1, nsec, w->fp);
+
+    for (int i = 0; i < nsec; i++) {
+        int idx = map[i] - 1;
+        const uint8_t *data = t->track.sectors[idx].data;
+        bool uniform = true;
+        for (int b = 1; b < SECTOR_SIZE && uniform; b++) {
+            if (data[b] != data[0]) uniform = false;
+        }
+
+        uint8_t type = 1;
+        if (t->status[idx] == IMAGE_SECTOR_DELETED) type = 3;
+        if (t->status[idx] == IMAGE_SECTOR_BAD_CRC) type = 5;
+        if (uniform) type++;
+
+        fputc(type, w->fp);
+        if (uniform) {
+            fputc(data[0], w->fp);
+        } else {
+            fwrite(data, 1, SECTOR_SIZE, w->fp);
+        }
+    }
+    return !ferror(w->fp);
+}
+
+static bool hfe_write_header(image_writer_t *w) {
+    uint8_t hdr[HFE_BLOCK];
+    memset(hdr, 0xFF, sizeof(hdr));
+    memcpy(hdr, "HXCPICFE", 8);
+    hdr[8] = 0;
+    hdr[9] = FLOPPY_TRACKS;
+    hdr[10] = IMAGE_SIDES;
+    hdr[11] = 0;
+    write_le16(hdr + 12, 500);
+    write_le16(hdr + 14, 300);
+    hdr[16] = 1;
+    hdr[17] = 1;
+    write_le16(hdr + 18, 1);
+
+    uint8_t list[HFE_BLOCK];
+    memset(list, 0xFF, sizeof(list));
+    for (int t = 0; t < FLOPPY_TRACKS; t++) {
+        write_le16(list + t * 4, 2 + t * HFE_TRACK_BLOCKS);
+        write_le16(list + t * 4 + 2, IMAGE_HFE_TRACK_BYTES * 2);
+    }
+
+    fwrite(hdr, 1, sizeof(hdr), w->fp);
+    fwrite(list, 1, sizeof(list), w->fp);
+    return !ferror(w->fp);
+}
+
+static bool hfe_write_track(image_writer_t *w, const image_track_t *t) {
+    static uint8_t pulses[IMAGE_FLUX_MAX];
+    static uint8_t bits[IMAGE_HFE_TRACK_BYTES];
+
+    size_t n = image_encode_track(t, pulses, sizeof(pulses));
+    size_t cells = 0;
+    for (size_t i = 0; i < n; i++) {
+        cells += (pulses[i] + MFM_PIO_OVERHEAD + HFE_CELL_COUNTS / 2) / HFE_CELL_COUNTS;
+    }
+    if (cells < HFE_TRACK_CELLS) {
+        mfm_encode_t pad;
+        mfm_encode_init(&pad, pulses + n, sizeof(pulses) - n);
+        mfm_encode_gap(&pad, (HFE_TRACK_CELLS - cells) / 16 + 1);
+        n += pad.pos;
+    }
+    hfe_pulses_to_bits(pulses, n, bits);
+
+    long off = (long)(2 + t->track.track * HFE_TRACK_BLOCKS) * HFE_BLOCK;
+    for (int c = 0; c * HFE_CHUNK < IMAGE_HFE_TRACK_BYTES; c++) {
+        uint8_t chunk[HFE_CHUNK] = {0};
+        size_t len = IMAGE_HFE_TRACK_BYTES - c * HFE_CHUNK;
+        if (len > HFE_CHUNK) len = HFE_CHUNK;
+        memcpy(chunk, bits + c * HFE_CHUNK, len);
+        fseek(w->fp, off + (long)c * HFE_BLOCK + t->track.side * HFE_CHUNK, SEEK_SET);
+        fwrite(chunk, 1, HFE_CHUNK, w->fp);
+    }
+    return !ferror(w->fp);
+}
+
+static void scp_put(image_writer_t *w, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) w->scp_checksum += data[i];
+    fwrite(data, 1, len, w->fp);
+    w->scp_pos += len;
+}
+
+static bool scp_write_header(image_writer_t *w) {
+    uint8_t hdr[SCP_DATA_START] = {0};
+    hdr[0] = 'S'; hdr[1] = 'C'; hdr[2] = 'P';
+    hdr[4] = 0x80;
+    hdr[5] = 1;
+    hdr[6] = 0;
+    hdr[7] = IMAGE_TRACK_COUNT - 1;
+    hdr[8] = 0x01;
+    fwrite(hdr, 1, sizeof(hdr), w->fp);
+    w->scp_pos = SCP_DATA_START;
+    return !ferror(w->fp);
+}
+
+static bool scp_write_track(image_writer_t *w, const image_track_t *t) {
+    static uint8_t pulses[IMAGE_FLUX_MAX];
+    static uint8_t flux[IMAGE_FLUX_MAX * 2];
+
+    size_t n = image_encode_track(t, pulses, sizeof(pulses));
+    uint32_t duration = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = (pulses[i] + MFM_PIO_OVERHEAD) * 5 / 3;
+        duration += v;
+        flux[i * 2] = v >> 8;
+        flux[i * 2 + 1] = v & 0xFF;
+    }
+
+    int idx = t->track.track * IMAGE_SIDES + t->track.side;
+    uint8_t tdh[16] = {'T', 'R', 'K', idx};
+    write_le32(tdh + 4, duration);
+    write_le32(tdh + 8, n);
+    write_le32(tdh + 12, sizeof(tdh));
+
+    w->scp_table[idx] = w->scp_pos;
+    scp_put(w, tdh, sizeof(tdh));
+    scp_put(w, flux, n * 2);
+    return !ferror(w->fp);
+}
+
+static bool scp_finish(image_writer_t *w) {
+    uint8_t table[SCP_TABLE_ENTRIES * 4] = {0};
+    for (int i = 0; i < IMAGE_TRACK_COUNT; i++) {
+        write_le32(table + i * 4, w->scp_table[i]);
+    }
+    for (size_t i = 0; i < sizeof(table); i++) w->scp_checksum += table[i];
+
+    uint8_t sum[4];
+    write_le32(sum, w->scp_checksum);
+    fseek(w->fp, 0x0C, SEEK_SET);
+    fwrite(sum, 1, 4, w->fp);
+    fwrite(table, 1, sizeof(table), w->fp);
+    return !ferror(w->fp);
+}
+
+static bool img_write_track(image_writer_t *w, const image_track_t *t) {
+    long off = (long)(t->track.track * IMAGE_SIDES + t->track.side) * IMG_TRACK_BYTES;
+    fseek(w->fp, off, SEEK_SET);
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        fwrite(t->track.sectors[i].data, 1, SECTOR_SIZE, w->fp);
+    }
+    return !ferror(w->fp);
+}
+
+bool image_writer_open(image_writer_t *w, const char *path, image_format_t format) {
+    memset(w, 0, sizeof(*w));
+    w->format = format;
+    if (format == IMAGE_UNKNOWN) return false;
+    w->fp = fopen(path, "w+b");
+    if (!w->fp) return false;
+
+    switch (format) {
+        case IMAGE_IMD: return imd_write_header(w);
+        case IMAGE_HFE: return hfe_write_header(w);
+        case IMAGE_SCP: return scp_write_header(w);
+        default: return true;
+    }
+}
+
+bool image_write_track(image_writer_t *w, const image_track_t *t) {
+    switch (w->format) {
+        case IMAGE_IMG: return img_write_track(w, t);
+        case IMAGE_IMD: return imd_write_track(w, t);
+        case IMAGE_HFE: return hfe_write_track(w, t);
+        case IMAGE_SCP: return scp_write_track(w, t);
+        default: return false;
+    }
+}
+
+bool image_writer_close(image_writer_t *w) {
+    if (!w->fp) return false;
+    bool ok = true;
+    if (w->format == IMAGE_SCP) ok = scp_finish(w);
+    if (fclose(w->fp) != 0) ok = false;
+    w->fp = NULL;
+    return ok;
+}
+
+typedef struct {
+    image_reader_t *reader;
+    image_track_t *out;
+    int idx;
+    bool threaded;
+    bool ok;
+} image_job_t;
+
+static void *image_job_run(void *arg) {
+    image_job_t *job = (image_job_t *)arg;
+    job->ok = image_read_track(job->reader, job->idx / IMAGE_SIDES, job->idx % IMAGE_SIDES, job->out);
+    return NULL;
+}
+
+static void image_count(image_stats_t *stats, const image_track_t *t) {
+    stats->tracks++;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        switch (t->status[i]) {
+            case IMAGE_SECTOR_OK: stats->ok++; break;
+            case IMAGE_SECTOR_MISSING: stats->missing++; break;
+            case IMAGE_SECTOR_BAD_CRC: stats->bad_crc++; break;
+            case IMAGE_SECTOR_DELETED: stats->deleted++; break;
+        }
+    }
+}
+
+bool image_convert(const char *in_path, image_format_t in_format,
+                   const char *out_path, image_format_t out_format,
+                   int threads, image_stats_t *stats) {
+    image_reader_t reader;
+    image_writer_t writer;
+    image_stats_t local = {0};
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (threads < 1) threads = 1;
+
+    if (!image_reader_open(&reader, in_path, in_format)) return false;
+    if (!image_writer_open(&writer, out_path, out_format)) {
+        image_reader_close(&reader);
+        return false;
+    }
+
+    image_track_t *slots = malloc(threads * sizeof(image_track_t));
+    image_job_t *jobs = malloc(threads * sizeof(image_job_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    bool ok = slots && jobs && tids;
+
+    for (int base = 0; ok && base < IMAGE_TRACK_COUNT; base += threads) {
+        int batch = IMAGE_TRACK_COUNT - base;
+        if (batch > threads) batch = threads;
+
+        for (int j = 0; j < batch; j++) {
+            jobs[j] = (image_job_t){ .reader = &reader, .out = &slots[j], .idx = base + j };
+            if (batch > 1 && pthread_create(&tids[j], NULL, image_job_run, &jobs[j]) == 0) {
+                jobs[j].threaded = true;
+            } else {
+                image_job_run(&jobs[j]);
+            }
+        }
+        for (int j = 0; j < batch; j++) {
+            if (jobs[j].threaded) pthread_join(tids[j], NULL);
+        }
+
+        for (int j = 0; j < batch && ok; j++) {
+            ok = jobs[j].ok && image_write_track(&writer, &slots[j]);
+            image_count(stats, &slots[j]);
+        }
+    }
+
+    free(slots);
+    free(jobs);
+    free(tids);
+    image_reader_close(&reader);
+    if (!image_writer_close(&writer)) ok = false;
+    return ok;
+}
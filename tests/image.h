@@ -0,0 +1,80 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "../src/floppy.h"
+
+#define IMAGE_SIDES 2
+#define IMAGE_TRACK_COUNT (FLOPPY_TRACKS * IMAGE_SIDES)
+#define IMAGE_FLUX_MAX 200000
+#define IMAGE_HFE_TRACK_BYTES 25000
+#define IMAGE_SCP_MAX_REVS 5
+
+typedef enum {
+    IMAGE_IMG = 0,
+    IMAGE_IMD,
+    IMAGE_HFE,
+    IMAGE_SCP,
+    IMAGE_UNKNOWN,
+} image_format_t;
+
+typedef enum {
+    IMAGE_SECTOR_OK = 0,
+    IMAGE_SECTOR_MISSING,
+    IMAGE_SECTOR_BAD_CRC,
+    IMAGE_SECTOR_DELETED,
+} image_status_t;
+
+typedef struct {
+    track_t track;
+    image_status_t status[SECTORS_PER_TRACK];
+} image_track_t;
+
+typedef struct {
+    int fd;
+    image_format_t format;
+    long offsets[IMAGE_TRACK_COUNT];
+    uint8_t scp_revs;
+    uint8_t scp_resolution;
+    uint16_t hfe_lengths[FLOPPY_TRACKS];
+} image_reader_t;
+
+typedef struct {
+    FILE *fp;
+    image_format_t format;
+    uint32_t scp_table[IMAGE_TRACK_COUNT];
+    uint32_t scp_checksum;
+    long scp_pos;
+} image_writer_t;
+
+typedef struct {
+    uint32_t tracks;
+    uint32_t ok;
+    uint32_t missing;
+    uint32_t bad_crc;
+    uint32_t deleted;
+} image_stats_t;
+
+image_format_t image_format_from_path(const char *path);
+const char *image_format_name(image_format_t format);
+
+void image_track_init(image_track_t *t, uint8_t track, uint8_t side);
+
+bool image_reader_open(image_reader_t *r, const char *path, image_format_t format);
+bool image_read_track(image_reader_t *r, uint8_t track, uint8_t side, image_track_t *out);
+void image_reader_close(image_reader_t *r);
+
+bool image_writer_open(image_writer_t *w, const char *path, image_format_t format);
+bool image_write_track(image_writer_t *w, const image_track_t *t);
+bool image_writer_close(image_writer_t *w);
+
+size_t image_encode_track(const image_track_t *t, uint8_t *pulses, size_t size);
+void image_decode_flux(const uint16_t *deltas, uint32_t count, image_track_t *t);
+
+bool image_convert(const char *in_path, image_format_t in_format,
+                   const char *out_path, image_format_t out_format,
+                   int threads, image_stats_t *stats);
+
+#endif
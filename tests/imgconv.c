@@ -0,0 +1,46 @@
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(void) {
+    fprintf(stderr, "usage: imgconv [-j threads] input.{img,imd,hfe,scp} output.{img,imd,hfe,scp}\n");
+}
+
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        if (opt == 'j') {
+            threads = atoi(optarg);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (argc - optind != 2) {
+        usage();
+        return 2;
+    }
+
+    const char *in = argv[optind];
+    const char *out = argv[optind + 1];
+    image_format_t in_fmt = image_format_from_path(in);
+    image_format_t out_fmt = image_format_from_path(out);
+    if (in_fmt == IMAGE_UNKNOWN || out_fmt == IMAGE_UNKNOWN) {
+        usage();
+        return 2;
+    }
+
+    image_stats_t stats;
+    if (!image_convert(in, in_fmt, out, out_fmt, threads, &stats)) {
+        fprintf(stderr, "imgconv: %s -> %s failed\n", in, out);
+        return 1;
+    }
+
+    printf("%s -> %s: %u tracks, %u ok, %u deleted, %u bad crc, %u missing\n",
+           image_format_name(in_fmt), image_format_name(out_fmt), stats.tracks,
+           stats.ok, stats.deleted, stats.bad_crc, stats.missing);
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "flux_sim.h"
+#include "../src/mfm_decode.h"
+#include "../src/mfm_encode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SCP "../../system-shock-multilingual-floppy-ibm-pc/disk1.scp"
+
+typedef struct {
+    const char *name;
+    void (*init)(mfm_t *m);
+    bool (*feed)(mfm_t *m, uint16_t delta, sector_t *out);
+} decoder_t;
+
+static const decoder_t decoders[] = {
+    { "mfm_adaptive", mfm_init, mfm_feed },
+};
+#define NUM_DECODERS (sizeof(decoders) / sizeof(decoders[0]))
+
+static const int16_t jitters[] = {0, 2, 4, 6, 8, 10, 12};
+static const int32_t drifts[] = {-80000, -50000, -20000, 0, 20000, 50000, 80000};
+static const int16_t shifts[] = {0, 2, 4, 6, 8};
+
+#define COUNT(a) (sizeof(a) / sizeof(a[0]))
+
+static const uint8_t synth_tracks[] = {0, 40, 79};
+static const uint8_t scp_tracks[] = {0, 20, 40, 60, 79};
+
+typedef struct {
+    uint32_t sectors;
+    uint32_t found;
+    uint32_t crc_errors;
+    uint64_t flux;
+    double seconds;
+} result_t;
+
+static uint8_t *load_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(*size);
+    if (!buf) { fclose(f); return NULL; }
+    if (fread(buf, 1, *size, f) != *size) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+static void decode_rev(const decoder_t *dec, flux_sim_t *sim, uint8_t track,
+                       uint8_t side, result_t *r) {
+    static uint16_t *deltas;
+    static uint32_t capacity;
+    if (sim->rev.count > capacity) {
+        deltas = realloc(deltas, sim->rev.count * sizeof(uint16_t));
+        capacity = sim->rev.count;
+    }
+
+    uint32_t flux = 0;
+    while (flux < capacity && flux_sim_next(sim, &deltas[flux])) flux++;
+
+    mfm_t mfm;
+    sector_t out;
+    bool seen[SECTORS_PER_TRACK] = {0};
+
+    clock_t start = clock();
+    dec->init(&mfm);
+    for (uint32_t i = 0; i < flux; i++) {
+        if (dec->feed(&mfm, deltas[i], &out) && out.valid &&
+            out.track == track && out.side == side &&
+            out.sector_n >= 1 && out.sector_n <= SECTORS_PER_TRACK) {
+            seen[out.sector_n - 1] = true;
+        }
+    }
+    r->seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (seen[i]) r->found++;
+    }
+    r->sectors += SECTORS_PER_TRACK;
+    r->crc_errors += mfm.crc_errors;
+    r->flux += flux;
+}
+
+static void perturb(flux_sim_t *sim, int16_t jitter, int32_t drift, int16_t shift,
+                    uint32_t seed) {
+    flux_sim_set_jitter(sim, jitter, seed);
+    flux_sim_set_drift(sim, drift);
+    flux_sim_set_peak_shift(sim, shift);
+}
+
+static void print_row(const char *source, const decoder_t *dec, int16_t jitter,
+                      int32_t drift, int16_t shift, const result_t *r) {
+    uint32_t errors = r->sectors - r->found;
+    printf("%s,%s,%d,%d,%d,%u,%u,%.4f,%u,%llu,%.2f\n",
+           source, dec->name, jitter, drift, shift, r->sectors, errors,
+           r->sectors ? (double)errors / r->sectors : 0,
+           r->crc_errors, (unsigned long long)r->flux,
+           r->flux ? r->seconds * 1e9 / r->flux : 0);
+}
+
+static size_t encode_synthetic(uint8_t track, uint8_t side, uint8_t *buf, size_t size) {
+    track_t trk = {.track = track, .side = side};
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        trk.sectors[s].track = track;
+        trk.sectors[s].side = side;
+        trk.sectors[s].sector_n = s + 1;
+        trk.sectors[s].size_code = 2;
+        trk.sectors[s].valid = true;
+        for (int i = 0; i < SECTOR_SIZE; i++) {
+            trk.sectors[s].data[i] = (uint8_t)((s * 37 + i * 11 + track) ^ (i >> 3));
+        }
+    }
+
+    mfm_encode_t enc;
+    mfm_encode_init(&enc, buf, size);
+    return mfm_encode_track(&enc, &trk);
+}
+
+static void sweep_synthetic(void) {
+    static uint8_t pulses[COUNT(synth_tracks)][2][200000];
+    size_t lens[COUNT(synth_tracks)][2];
+
+    for (size_t t = 0; t < COUNT(synth_tracks); t++) {
+        for (int side = 0; side < 2; side++) {
+            lens[t][side] = encode_synthetic(synth_tracks[t], side, pulses[t][side],
+                                             sizeof(pulses[t][side]));
+        }
+    }
+
+    for (size_t d = 0; d < NUM_DECODERS; d++)
+    for (size_t j = 0; j < COUNT(jitters); j++)
+    for (size_t k = 0; k < COUNT(drifts); k++)
+    for (size_t s = 0; s < COUNT(shifts); s++) {
+        result_t r = {0};
+        for (size_t t = 0; t < COUNT(synth_tracks); t++) {
+            for (int side = 0; side < 2; side++) {
+                flux_sim_t sim;
+                flux_sim_from_track(&sim, pulses[t][side], lens[t][side]);
+                perturb(&sim, jitters[j], drifts[k], shifts[s], 12345 + t * 2 + side);
+                decode_rev(&decoders[d], &sim, synth_tracks[t], side, &r);
+                flux_sim_close(&sim);
+            }
+        }
+        print_row("synthetic", &decoders[d], jitters[j], drifts[k], shifts[s], &r);
+    }
+}
+
+static void sweep_scp(const char *path) {
+    size_t size;
+    uint8_t *data = load_file(path, &size);
+    if (!data) {
+        fprintf(stderr, "margin_sweep: cannot read %s, skipping SCP sweep\n", path);
+        return;
+    }
+
+    flux_sim_t sim;
+    if (!flux_sim_open_scp(&sim, data, size)) {
+        fprintf(stderr, "margin_sweep: %s is not an SCP file\n", path);
+        free(data);
+        return;
+    }
+
+    for (size_t d = 0; d < NUM_DECODERS; d++)
+    for (size_t j = 0; j < COUNT(jitters); j++)
+    for (size_t k = 0; k < COUNT(drifts); k++)
+    for (size_t s = 0; s < COUNT(shifts); s++) {
+        result_t r = {0};
+        for (size_t t = 0; t < COUNT(scp_tracks); t++) {
+            for (int side = 0; side < 2; side++) {
+                if (!flux_sim_seek(&sim, scp_tracks[t], side, 0)) continue;
+                perturb(&sim, jitters[j], drifts[k], shifts[s], 12345 + t * 2 + side);
+                decode_rev(&decoders[d], &sim, scp_tracks[t], side, &r);
+            }
+        }
+        print_row("scp", &decoders[d], jitters[j], drifts[k], shifts[s], &r);
+    }
+
+    flux_sim_close(&sim);
+    free(data);
+}
+
+int main(int argc, char **argv) {
+    const char *scp_path = argc > 1 ? argv[1] : DEFAULT_SCP;
+
+    printf("source,decoder,jitter,drift_ppm,peak_shift,sectors,errors,error_rate,"
+           "crc_errors,flux,ns_per_flux\n");
+
+    sweep_synthetic();
+    sweep_scp(scp_path);
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "image.h"
+#include "../src/fat12.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MKIMG_MAX_FILES 224
+
+static void usage(void) {
+    fprintf(stderr, "usage: mkimg [-l label] output.{img,imd,hfe,scp} file...\n");
+}
+
+static bool file_read(void *ctx, uint32_t offset, uint8_t *buf, uint16_t len) {
+    FILE *f = ctx;
+    if (fseek(f, offset, SEEK_SET) != 0) return false;
+    return fread(buf, 1, len, f) == len;
+}
+
+static bool image_write(void *ctx, track_t *track) {
+    image_writer_t *w = ctx;
+    image_track_t t;
+    image_track_init(&t, track->track, track->side);
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        memcpy(t.track.sectors[i].data, track->sectors[i].data, SECTOR_SIZE);
+        t.track.sectors[i].valid = true;
+        t.status[i] = IMAGE_SECTOR_OK;
+    }
+    return image_write_track(w, &t);
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+int main(int argc, char **argv) {
+    const char *label = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:")) != -1) {
+        if (opt == 'l') {
+            label = optarg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    int count = argc - optind - 1;
+    if (count < 1 || count > MKIMG_MAX_FILES) {
+        usage();
+        return 2;
+    }
+
+    const char *out = argv[optind];
+    image_format_t fmt = image_format_from_path(out);
+    if (fmt == IMAGE_UNKNOWN) {
+        usage();
+        return 2;
+    }
+
+    static fat12_build_file_t files[MKIMG_MAX_FILES];
+    for (int i = 0; i < count; i++) {
+        const char *path = argv[optind + 1 + i];
+        FILE *f = fopen(path, "rb");
+        if (!f) {
+            fprintf(stderr, "mkimg: cannot open %s\n", path);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        if (size < 0 || (unsigned long)size > UINT32_MAX) {
+            fprintf(stderr, "mkimg: %s is too large\n", path);
+            return 1;
+        }
+        files[i].name = base_name(path);
+        files[i].size = (uint32_t)size;
+        files[i].read = file_read;
+        files[i].ctx = f;
+    }
+
+    image_writer_t w;
+    if (!image_writer_open(&w, out, fmt)) {
+        fprintf(stderr, "mkimg: cannot create %s\n", out);
+        return 1;
+    }
+
+    fat12_io_t io = { .read = NULL, .write = image_write, .ctx = &w };
+    fat12_err_t err = fat12_build(io, label, files, count, true);
+    bool ok = image_writer_close(&w);
+
+    for (int i = 0; i < count; i++) fclose(files[i].ctx);
+
+    if (err != FAT12_OK || !ok) {
+        fprintf(stderr, "mkimg: build failed (%s)\n",
+                err == FAT12_ERR_FULL ? "disk full" :
+                err == FAT12_ERR_INVALID ? "invalid or duplicate 8.3 name" :
+                err == FAT12_ERR_READ ? "read" : "write");
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint32_t n = (files[i].size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        uint16_t lba = fat12_build_cluster_lba(files[i].start_cluster);
+        printf("%-12s %8u bytes  cluster %4u  track %2u/%u", files[i].name,
+               files[i].size, files[i].start_cluster,
+               lba / (SECTORS_PER_TRACK * 2), (lba / SECTORS_PER_TRACK) % 2);
+        if (n) printf("  %u clusters\n", n);
+        else printf("  empty\n");
+    }
+    return 0;
+}
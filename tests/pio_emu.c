@@ -1,10 +1,31 @@
 #include "pio_emu.h"
 #include <string.h>
 
+const uint16_t pio_emu_flux_read_prog[] = {
+    PIO_JMP(JMP_X_DEC, 1),
+    PIO_JMP(JMP_PIN, 3),
+    PIO_JMP(JMP_ALWAYS, 0),
+    PIO_JMP(JMP_X_DEC, 4),
+    PIO_JMP_D(JMP_PIN, 3, 1),
+    PIO_IN(IN_PINS, 1),
+    PIO_IN(IN_X, 15),
+    PIO_JMP(JMP_X_DEC, 0),
+};
+
+const uint16_t pio_emu_flux_write_prog[] = {
+    PIO_PULL_BLOCK,
+    PIO_OUT(OUT_X, 8),
+    PIO_SET(SET_PINS, 0),
+    PIO_NOP_D(13),
+    PIO_SET(SET_PINS, 1),
+    PIO_JMP(JMP_X_DEC, 5),
+};
+
 void pio_emu_init(pio_emu_t *emu) {
     memset(emu, 0, sizeof(*emu));
     emu->in_shift_right = true;
     emu->out_shift_right = true;
+    emu->osr_shift_count = 32;
 }
 
 void pio_emu_load(pio_emu_t *emu, const uint16_t *program, uint8_t len,
@@ -115,6 +136,16 @@ void pio_emu_step(pio_emu_t *emu) {
     }
 
     case PIO_OP_IN: {
+        uint8_t bits = arg2 ? arg2 : 32;
+        if (emu->autopush_threshold > 0 &&
+            emu->isr_shift_count + bits >= emu->autopush_threshold &&
+            emu->rx_count >= PIO_EMU_FIFO_DEPTH) {
+            emu->stalled = true;
+            emu->rx_stall_cycles++;
+            advance_pc = false;
+            delay = 0;
+            break;
+        }
         uint32_t value = 0;
         switch (arg1) {
         case IN_PINS: value = emu->pin_values; break;
@@ -148,7 +179,10 @@ void pio_emu_step(pio_emu_t *emu) {
         bool block = (arg1 >> 1) & 1;
         if (is_pull) {
             uint32_t tx_val;
-            if (pio_emu_tx_pop(emu, &tx_val)) {
+            if (emu->autopull_threshold > 0 &&
+                emu->osr_shift_count < emu->autopull_threshold) {
+                break;
+            } else if (pio_emu_tx_pop(emu, &tx_val)) {
                 emu->osr = tx_val;
                 emu->osr_shift_count = 0;
             } else if (block) {
@@ -90,8 +90,29 @@ typedef struct {
     uint8_t delay_remaining;
     uint64_t cycle_count;
     bool stalled;
+    uint64_t rx_stall_cycles;
 } pio_emu_t;
 
+#define PIO_JMP(cond, addr)        (uint16_t)((0 << 13) | ((cond) << 5) | (addr))
+#define PIO_JMP_D(cond, addr, d)   (uint16_t)((0 << 13) | ((d) << 8) | ((cond) << 5) | (addr))
+#define PIO_IN(src, bits)          (uint16_t)((2 << 13) | ((src) << 5) | (bits))
+#define PIO_OUT(dst, bits)         (uint16_t)((3 << 13) | ((dst) << 5) | (bits))
+#define PIO_PULL_BLOCK             (uint16_t)((4 << 13) | (7 << 5))
+#define PIO_SET(dst, val)          (uint16_t)((7 << 13) | ((dst) << 5) | (val))
+#define PIO_SET_D(dst, val, d)     (uint16_t)((7 << 13) | ((d) << 8) | ((dst) << 5) | (val))
+#define PIO_NOP_D(d)               (uint16_t)((5 << 13) | ((d) << 8) | (2 << 5) | 2)
+
+// Hand-assembled from src/flux_read.pio and src/flux_write.pio
+extern const uint16_t pio_emu_flux_read_prog[];
+#define FLUX_READ_LEN 8
+#define FLUX_READ_WRAP_TARGET 0
+#define FLUX_READ_WRAP 7
+
+extern const uint16_t pio_emu_flux_write_prog[];
+#define FLUX_WRITE_LEN 6
+#define FLUX_WRITE_WRAP_TARGET 0
+#define FLUX_WRITE_WRAP 5
+
 void pio_emu_init(pio_emu_t *emu);
 void pio_emu_load(pio_emu_t *emu, const uint16_t *program, uint8_t len,
                   uint8_t wrap_target, uint8_t wrap);
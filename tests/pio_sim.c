@@ -2,6 +2,7 @@
 #include "flux_sim.h"
 #include "../src/floppy.h"
 #include "../src/mfm_encode.h"
+#include "hardware/clocks.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -9,6 +10,21 @@
 static pio_sim_drive_t *g_drive = NULL;
 extern floppy_t *pio_sim_floppy_ref;
 
+#define COSIM_TICK_HZ 3600000000ULL
+#define COSIM_READ_HZ 72000000
+#define COSIM_READ_TICKS (COSIM_TICK_HZ / COSIM_READ_HZ)
+#define COSIM_WRITE_DIV 3
+#define COSIM_PULSE_CYCLES 12
+#define COSIM_INDEX_CYCLES (COSIM_READ_HZ / 500)
+#define COSIM_SETTLE_CYCLES 4096
+#define PIO_SIM_REV_TICKS 4800000
+
+static const pio_sim_cpu_cost_t cosim_default_cost = {
+    .read_word_cycles = 300,
+    .write_word_cycles = 40,
+    .poll_cycles = 8,
+};
+
 static uint32_t read_le32(const uint8_t *p) {
     return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
 }
@@ -24,13 +40,73 @@ void pio_sim_init(pio_sim_drive_t *drive) {
 void pio_sim_free(pio_sim_drive_t *drive) {
     for (int t = 0; t < 80; t++) {
         for (int s = 0; s < 2; s++) {
-            free(drive->tracks[t][s].deltas);
+            for (int r = 0; r < PIO_SIM_MAX_REVS; r++) {
+                free(drive->tracks[t][s].revs[r]);
+            }
         }
     }
+    free(drive->media_buf);
     free(drive->write_capture);
+    free(drive->cosim.edges);
     memset(drive, 0, sizeof(*drive));
 }
 
+static void pio_sim_store_track(pio_sim_track_t *t, uint16_t *deltas, uint32_t count) {
+    for (int r = 0; r < PIO_SIM_MAX_REVS; r++) {
+        free(t->revs[r]);
+        t->revs[r] = NULL;
+        t->counts[r] = 0;
+    }
+    t->revs[0] = deltas;
+    t->counts[0] = count;
+    t->num_revs = 1;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t rev_ticks(const uint16_t *d, uint32_t n) {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += d[i];
+    return sum;
+}
+
+static void pio_sim_splice_write(pio_sim_track_t *t, const uint16_t *w, uint32_t wn,
+                                 uint64_t angle) {
+    const uint16_t *old = t->num_revs ? t->revs[0] : NULL;
+    uint32_t on = t->num_revs ? t->counts[0] : 0;
+    uint64_t rev = old ? rev_ticks(old, on) : 0;
+    if (rev < PIO_SIM_REV_TICKS * 95 / 100) rev = PIO_SIM_REV_TICKS;
+    uint64_t len = rev_ticks(w, wn);
+    angle %= rev;
+
+    uint32_t *times = malloc((wn + on + 1) * sizeof(uint32_t));
+    uint32_t n = 0;
+
+    uint64_t o = 0;
+    for (uint32_t i = 0; i < wn; i++) {
+        o += w[i];
+        if (o + rev >= len) times[n++] = (uint32_t)((angle + o) % rev);
+    }
+    uint64_t p = 0;
+    for (uint32_t i = 0; i < on; i++) {
+        p += old[i];
+        uint64_t pos = p % rev;
+        if ((pos + rev - angle) % rev >= len) times[n++] = (uint32_t)pos;
+    }
+    qsort(times, n, sizeof(uint32_t), cmp_u32);
+
+    uint16_t *deltas = malloc((n ? n : 1) * sizeof(uint16_t));
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t d = i ? times[i] - times[i - 1] : times[0] + rev - times[n - 1];
+        deltas[i] = d > 0xFFFF ? 0xFFFF : (d == 0 ? 1 : (uint16_t)d);
+    }
+    free(times);
+    pio_sim_store_track(t, deltas, n);
+}
+
 bool pio_sim_load_scp(pio_sim_drive_t *drive, uint8_t *data, size_t size) {
     if (size < 0x10 || data[0] != 'S' || data[1] != 'C' || data[2] != 'P')
         return false;
@@ -39,6 +115,8 @@ bool pio_sim_load_scp(pio_sim_drive_t *drive, uint8_t *data, size_t size) {
     uint8_t resolution = data[9];
     uint32_t scale_num = (resolution + 1) * 3;
 
+    if (num_revs > PIO_SIM_MAX_REVS) num_revs = PIO_SIM_MAX_REVS;
+
     for (int track = 0; track < 80; track++) {
         for (int side = 0; side < 2; side++) {
             uint16_t scp_idx = track * 2 + side;
@@ -46,33 +124,38 @@ bool pio_sim_load_scp(pio_sim_drive_t *drive, uint8_t *data, size_t size) {
             if (table_off + 4 > size) continue;
 
             uint32_t tdh_off = read_le32(data + table_off);
-            if (tdh_off == 0 || tdh_off + 4 + 12 > size) continue;
+            if (tdh_off == 0) continue;
 
-            uint8_t *rev_entry = data + tdh_off + 4;
-            uint32_t flux_count = read_le32(rev_entry + 4);
-            uint32_t data_off = read_le32(rev_entry + 8);
+            pio_sim_track_t *t = &drive->tracks[track][side];
+            for (int rev = 0; rev < num_revs; rev++) {
+                if (tdh_off + 4 + (rev + 1) * 12 > size) break;
 
-            if (tdh_off + data_off + flux_count * 2 > size) continue;
+                uint8_t *rev_entry = data + tdh_off + 4 + rev * 12;
+                uint32_t flux_count = read_le32(rev_entry + 4);
+                uint32_t data_off = read_le32(rev_entry + 8);
 
-            uint8_t *flux_data = data + tdh_off + data_off;
+                if (tdh_off + data_off + flux_count * 2 > size) break;
 
-            drive->tracks[track][side].deltas = malloc(flux_count * sizeof(uint16_t));
-            if (!drive->tracks[track][side].deltas) continue;
+                uint8_t *flux_data = data + tdh_off + data_off;
 
-            uint32_t out = 0;
-            uint32_t acc = 0;
-            for (uint32_t i = 0; i < flux_count; i++) {
-                uint16_t val = read_be16(flux_data + i * 2);
-                if (val == 0) { acc += 65536; continue; }
-                uint32_t total = acc + val;
-                acc = 0;
-                uint32_t d = (total * scale_num + 2) / 5;
-                if (d > 0xFFFF) d = 0xFFFF;
-                drive->tracks[track][side].deltas[out++] = (uint16_t)d;
-            }
-            drive->tracks[track][side].count = out;
+                uint16_t *deltas = malloc(flux_count * sizeof(uint16_t));
+                if (!deltas) break;
 
-            (void)num_revs;
+                uint32_t out = 0;
+                uint32_t acc = 0;
+                for (uint32_t i = 0; i < flux_count; i++) {
+                    uint16_t val = read_be16(flux_data + i * 2);
+                    if (val == 0) { acc += 65536; continue; }
+                    uint32_t total = acc + val;
+                    acc = 0;
+                    uint32_t d = (total * scale_num + 2) / 5;
+                    if (d > 0xFFFF) d = 0xFFFF;
+                    deltas[out++] = (uint16_t)d;
+                }
+                t->revs[rev] = deltas;
+                t->counts[rev] = out;
+                t->num_revs = rev + 1;
+            }
         }
     }
 
@@ -83,17 +166,313 @@ void pio_sim_install(pio_sim_drive_t *drive) {
     g_drive = drive;
 }
 
-static void pio_sim_load_track(void) {
-    if (!g_drive) return;
+void pio_sim_set_media(pio_sim_drive_t *drive, const pio_sim_media_t *media) {
+    if (media) {
+        drive->media = *media;
+        if (drive->media.weak_count > PIO_SIM_MAX_WEAK) drive->media.weak_count = PIO_SIM_MAX_WEAK;
+    } else {
+        memset(&drive->media, 0, sizeof(drive->media));
+    }
+}
+
+static uint32_t media_rand(uint32_t *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+static int32_t media_spread(uint32_t *seed, int32_t range) {
+    if (range <= 0) return 0;
+    return (int32_t)(media_rand(seed) % (2 * range + 1)) - range;
+}
+
+static uint16_t *media_render(const uint16_t *src, uint32_t *count_io,
+                              uint8_t track, uint8_t side, uint32_t seq) {
+    uint32_t count = *count_io;
+    pio_sim_media_t *m = &g_drive->media;
+
+    if (count > g_drive->media_capacity) {
+        g_drive->media_buf = realloc(g_drive->media_buf, count * sizeof(uint16_t));
+        g_drive->media_capacity = count;
+    }
+    uint16_t *out = g_drive->media_buf;
+
+    uint32_t seed = m->seed ^ ((track * 2 + side) * 2654435761u) ^ (seq * 40503u);
+    int32_t shift = m->peak_shift_outer +
+                    (m->peak_shift_inner - m->peak_shift_outer) * track / (FLOPPY_TRACKS - 1);
+    uint32_t phase = media_rand(&seed) << 1;
+
+    int32_t weak_start[PIO_SIM_MAX_WEAK];
+    int32_t weak_end[PIO_SIM_MAX_WEAK];
+    for (int w = 0; w < m->weak_count; w++) {
+        weak_start[w] = weak_end[w] = -1;
+        if (m->weak[w].track != track || m->weak[w].side != side) continue;
+        if (m->weak[w].approach_steps && g_drive->approach >= m->weak[w].approach_steps) continue;
+        weak_start[w] = (int32_t)((uint64_t)count * m->weak[w].start_permille / 1000);
+        weak_end[w] = weak_start[w] + (int32_t)((uint64_t)count * m->weak[w].length_permille / 1000);
+    }
+
+    int32_t carry = 0;
+    int32_t dropped = 0;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t raw = src[i];
+        int32_t d = raw + carry + dropped;
+        carry = 0;
+        dropped = 0;
+
+        if (shift != 0 && i + 1 < count) {
+            int32_t next = src[i + 1];
+            if (next > raw + raw / 4) {
+                d += shift;
+                carry = -shift;
+            } else if (raw > next + next / 4) {
+                d -= shift;
+                carry = shift;
+            }
+        }
+
+        if (m->wobble_ppm != 0 && m->wobble_cycles > 0) {
+            uint32_t p = (uint32_t)((uint64_t)i * m->wobble_cycles * 0x10000 / count + phase) & 0xFFFF;
+            int32_t tri = p < 0x8000 ? (int32_t)p * 2 - 0x8000 : 0x17FFF - (int32_t)p * 2;
+            d += (int32_t)((int64_t)d * m->wobble_ppm * tri / 0x8000 / 1000000);
+        }
+
+        d += media_spread(&seed, m->jitter);
+
+        bool drop = false;
+        for (int w = 0; w < m->weak_count; w++) {
+            if ((int32_t)i >= weak_start[w] && (int32_t)i < weak_end[w]) {
+                d += media_spread(&seed, m->weak[w].spread);
+                uint32_t roll = (media_rand(&seed) << 15 | media_rand(&seed)) % 1000000;
+                if (roll < m->weak[w].dropout_ppm) drop = true;
+            }
+        }
+
+        if (drop && i + 1 < count) {
+            dropped = d;
+            continue;
+        }
+
+        if (d < 1) d = 1;
+        if (d > 0xFFFF) d = 0xFFFF;
+        out[n++] = (uint16_t)d;
+    }
+
+    *count_io = n;
+    return out;
+}
+
+static void pio_sim_next_rev(void) {
     pio_sim_track_t *t = &g_drive->tracks[g_drive->head_track][g_drive->head_side];
-    g_drive->read_buf = t->deltas;
-    g_drive->read_count = t->count;
     g_drive->read_pos = 0;
+    if (t->num_revs == 0) {
+        g_drive->read_buf = NULL;
+        g_drive->read_count = 0;
+        return;
+    }
+
+    uint32_t seq = g_drive->rev_seq++;
+    uint8_t rev = seq % t->num_revs;
+    g_drive->read_count = t->counts[rev];
+    if (g_drive->media.enabled) {
+        g_drive->read_buf = media_render(t->revs[rev], &g_drive->read_count,
+                                         g_drive->head_track, g_drive->head_side, seq);
+    } else {
+        g_drive->read_buf = t->revs[rev];
+    }
+}
+
+static uint64_t pio_sim_angle(void) {
+    if (g_drive->index_synced || !g_drive->read_buf) return 0;
+    return rev_ticks(g_drive->read_buf, g_drive->read_pos);
+}
+
+static void pio_sim_load_track(void) {
+    if (!g_drive) return;
+    g_drive->index_synced = false;
+    pio_sim_next_rev();
     g_drive->counter = 0;
     g_drive->index_state = false;
     g_drive->flux_in_rev = 0;
 }
 
+static bool cosim_active(void) {
+    return g_drive && g_drive->cosim.enabled;
+}
+
+static uint32_t cosim_next_flux(pio_sim_cosim_t *c) {
+    if (!g_drive->read_buf || g_drive->read_count == 0) return 0;
+    if (g_drive->read_pos >= g_drive->read_count) {
+        pio_sim_next_rev();
+        c->index_left = COSIM_INDEX_CYCLES;
+    }
+    g_drive->index_synced = false;
+    g_drive->revolutions += 1.0 / g_drive->read_count;
+    return (uint32_t)g_drive->read_buf[g_drive->read_pos++] * (COSIM_READ_HZ / 24000000);
+}
+
+static void cosim_step_read(pio_sim_cosim_t *c) {
+    pio_emu_t *emu = &c->read_emu;
+
+    if (c->pulse_left > 0 && --c->pulse_left == 0) {
+        emu->jmp_pin = true;
+    }
+    if (c->flux_left == 0) {
+        c->flux_left = cosim_next_flux(c);
+    } else if (--c->flux_left == 0) {
+        emu->jmp_pin = false;
+        c->pulse_left = COSIM_PULSE_CYCLES;
+        c->flux_left = cosim_next_flux(c);
+    }
+    if (c->index_left > 0) c->index_left--;
+    emu->pin_values = c->index_left > 0 ? 0 : 1;
+
+    pio_emu_step(emu);
+    if (emu->rx_count > c->stats.rx_peak) c->stats.rx_peak = emu->rx_count;
+}
+
+static void cosim_push_edge(pio_sim_cosim_t *c, uint64_t interval) {
+    if (c->edge_count >= c->edge_capacity) {
+        uint32_t cap = c->edge_capacity ? c->edge_capacity * 2 : 4096;
+        c->edges = realloc(c->edges, cap * sizeof(uint16_t));
+        c->edge_capacity = cap;
+    }
+    c->edges[c->edge_count++] = interval > 0xFFFF ? 0xFFFF : (uint16_t)interval;
+}
+
+static void cosim_step_write(pio_sim_cosim_t *c) {
+    pio_emu_t *emu = &c->write_emu;
+    uint32_t prev_pins = emu->set_pins;
+
+    pio_emu_step(emu);
+
+    if ((prev_pins & 1) && !(emu->set_pins & 1)) {
+        if (c->have_edge) cosim_push_edge(c, emu->cycle_count - c->last_edge);
+        c->last_edge = emu->cycle_count;
+        c->have_edge = true;
+    }
+    if (emu->stalled && !c->write_stalled && c->have_edge) {
+        c->write_stalls++;
+        c->stall_start = emu->cycle_count;
+    }
+    c->write_stalled = emu->stalled;
+}
+
+static void cosim_run_until(pio_sim_cosim_t *c, uint64_t t) {
+    while (c->pio_time + COSIM_READ_TICKS <= t) {
+        c->pio_time += COSIM_READ_TICKS;
+        if (c->read_enabled) cosim_step_read(c);
+        if (++c->write_phase == COSIM_WRITE_DIV) {
+            c->write_phase = 0;
+            if (c->write_enabled) cosim_step_write(c);
+        }
+    }
+    c->now = t;
+}
+
+static void cosim_cpu(pio_sim_cosim_t *c, uint32_t cycles) {
+    c->stats.cpu_busy_cycles += cycles;
+    cosim_run_until(c, c->now + (uint64_t)cycles * c->cpu_ticks);
+}
+
+static void cosim_idle(pio_sim_cosim_t *c, uint64_t ticks) {
+    c->wait_ticks += ticks;
+    c->stats.cpu_wait_cycles = c->wait_ticks / c->cpu_ticks;
+    cosim_run_until(c, c->now + ticks);
+}
+
+static void cosim_poll(pio_sim_cosim_t *c, bool idle) {
+    if (idle) {
+        cosim_idle(c, (uint64_t)c->cost.poll_cycles * c->cpu_ticks);
+    } else {
+        cosim_cpu(c, c->cost.poll_cycles);
+    }
+}
+
+static void cosim_restart(pio_emu_t *emu) {
+    emu->isr = 0;
+    emu->isr_shift_count = 0;
+    emu->osr_shift_count = 32;
+    emu->delay_remaining = 0;
+    emu->stalled = false;
+    emu->pc = 0;
+}
+
+static void cosim_clear_fifos(pio_emu_t *emu) {
+    emu->rx_head = emu->rx_count = 0;
+    emu->tx_head = emu->tx_count = 0;
+}
+
+static void cosim_write_begin(pio_sim_cosim_t *c) {
+    c->edge_count = 0;
+    c->have_edge = false;
+    c->write_stalls = 0;
+    c->write_stalled = false;
+    c->write_primed = false;
+}
+
+static void cosim_write_end(pio_sim_cosim_t *c) {
+    for (int i = 0; i < COSIM_SETTLE_CYCLES && !c->write_stalled; i++) {
+        cosim_step_write(c);
+    }
+    if (c->have_edge && c->write_stalled) {
+        cosim_push_edge(c, c->stall_start + 2 - c->last_edge);
+    }
+    if (c->write_stalls > 1) {
+        c->stats.tx_underruns += c->write_stalls - 1;
+    }
+}
+
+void pio_sim_enable_cosim(pio_sim_drive_t *drive, const pio_sim_cpu_cost_t *cost) {
+    pio_sim_cosim_t *c = &drive->cosim;
+    free(c->edges);
+    memset(c, 0, sizeof(*c));
+
+    c->enabled = true;
+    c->cost = cost ? *cost : cosim_default_cost;
+    c->cpu_ticks = COSIM_TICK_HZ / clock_get_hz(clk_sys);
+
+    pio_emu_init(&c->read_emu);
+    pio_emu_load(&c->read_emu, pio_emu_flux_read_prog, FLUX_READ_LEN,
+                 FLUX_READ_WRAP_TARGET, FLUX_READ_WRAP);
+    c->read_emu.in_shift_right = true;
+    c->read_emu.autopush_threshold = 32;
+    c->read_emu.jmp_pin = true;
+    c->read_emu.pin_values = 1;
+
+    pio_emu_init(&c->write_emu);
+    pio_emu_load(&c->write_emu, pio_emu_flux_write_prog, FLUX_WRITE_LEN,
+                 FLUX_WRITE_WRAP_TARGET, FLUX_WRITE_WRAP);
+    c->write_emu.out_shift_right = true;
+    c->write_emu.autopull_threshold = 8;
+    c->write_emu.set_pins = 1;
+
+    pio_sim_reset_cosim_stats(drive);
+}
+
+void pio_sim_reset_cosim_stats(pio_sim_drive_t *drive) {
+    pio_sim_cosim_t *c = &drive->cosim;
+    memset(&c->stats, 0, sizeof(c->stats));
+    c->stats.tx_low = PIO_EMU_FIFO_DEPTH;
+    c->wait_ticks = 0;
+    c->read_emu.rx_stall_cycles = 0;
+}
+
+void pio_sim_print_cosim_stats(const pio_sim_drive_t *drive) {
+    const pio_sim_cosim_stats_t *s = &drive->cosim.stats;
+    uint64_t total = s->cpu_busy_cycles + s->cpu_wait_cycles;
+    double headroom = total ? 100.0 * s->cpu_wait_cycles / total : 0;
+    printf("  CPU: %llu busy, %llu waiting (%.1f%% headroom)\n",
+           (unsigned long long)s->cpu_busy_cycles,
+           (unsigned long long)s->cpu_wait_cycles, headroom);
+    printf("  RX: %u words, FIFO peak %u/%d, PIO stalled %llu cycles\n",
+           s->rx_words, s->rx_peak, PIO_EMU_FIFO_DEPTH,
+           (unsigned long long)s->rx_stall_cycles);
+    printf("  TX: %u words, FIFO low %u/%d, %u underruns\n",
+           s->tx_words, s->tx_words ? s->tx_low : PIO_EMU_FIFO_DEPTH,
+           PIO_EMU_FIFO_DEPTH, s->tx_underruns);
+}
+
 void gpio_init(uint pin) { (void)pin; }
 void gpio_set_dir(uint pin, bool out) {
     if (!g_drive || !pio_sim_floppy_ref) return;
@@ -104,6 +483,12 @@ void gpio_set_dir(uint pin, bool out) {
     if (pin == f->pins.direction) {
         g_drive->step_direction_inward = going_low;
     } else if (pin == f->pins.step && going_low) {
+        if (g_drive->approach > 0 && g_drive->last_step_inward == g_drive->step_direction_inward) {
+            if (g_drive->approach < 255) g_drive->approach++;
+        } else {
+            g_drive->approach = 1;
+        }
+        g_drive->last_step_inward = g_drive->step_direction_inward;
         if (g_drive->step_direction_inward && g_drive->head_track < 79) {
             g_drive->head_track++;
         } else if (!g_drive->step_direction_inward && g_drive->head_track > 0) {
@@ -117,19 +502,36 @@ void gpio_set_dir(uint pin, bool out) {
             pio_sim_load_track();
         }
     } else if (pin == f->pins.write_gate) {
+        pio_sim_cosim_t *c = &g_drive->cosim;
         if (going_low) {
             g_drive->write_capture_count = 0;
+            g_drive->write_angle = pio_sim_angle();
+            if (c->enabled) cosim_write_begin(c);
         } else if (g_drive->write_capture_count > 0) {
+            if (c->enabled) cosim_write_end(c);
+            pio_sim_track_t *t = &g_drive->tracks[g_drive->head_track][g_drive->head_side];
             if (g_drive->fault_writes_remaining > 0) {
                 g_drive->fault_writes_remaining--;
+                return;
+            }
+            pio_sim_media_t *m = &g_drive->media;
+            for (int w = 0; w < m->weak_count; w++) {
+                if (m->weak[w].write_heals && m->weak[w].track == g_drive->head_track &&
+                    m->weak[w].side == g_drive->head_side) {
+                    m->weak[w].length_permille = 0;
+                }
+            }
+            if (c->enabled) {
+                pio_sim_splice_write(t, c->edges, c->edge_count, g_drive->write_angle);
+                pio_sim_load_track();
             } else {
-                pio_sim_track_t *t = &g_drive->tracks[g_drive->head_track][g_drive->head_side];
-                free(t->deltas);
-                t->deltas = malloc(g_drive->write_capture_count * sizeof(uint16_t));
-                t->count = g_drive->write_capture_count;
+                uint16_t *deltas = malloc(g_drive->write_capture_count * sizeof(uint16_t));
                 for (uint32_t i = 0; i < g_drive->write_capture_count; i++) {
-                    t->deltas[i] = g_drive->write_capture[i] + MFM_PIO_OVERHEAD;
+                    deltas[i] = g_drive->write_capture[i] + MFM_PIO_OVERHEAD;
                 }
+                pio_sim_splice_write(t, deltas, g_drive->write_capture_count,
+                                     g_drive->write_angle);
+                free(deltas);
                 pio_sim_load_track();
             }
         }
@@ -150,7 +552,9 @@ bool gpio_get(uint pin) {
     }
     if (pin == f->pins.index) {
         g_drive->index_poll_count++;
-        return (g_drive->index_poll_count & 0x100) != 0;
+        bool high = (g_drive->index_poll_count & 0x100) != 0;
+        if (!high) g_drive->index_synced = true;
+        return high;
     }
     if (pin == f->pins.disk_change) {
         return true;
@@ -176,20 +580,46 @@ void pio_sm_init(PIO pio, uint sm, uint offset, const pio_sm_config *config) {
 }
 
 void pio_sm_exec(PIO pio, uint sm, uint instr) {
-    (void)pio; (void)sm; (void)instr;
+    (void)sm;
+    if (!cosim_active()) return;
+    if (pio->id == 0) {
+        g_drive->cosim.read_emu.x = instr;
+    } else {
+        g_drive->cosim.write_emu.pc = instr;
+    }
 }
 
-void pio_sm_restart(PIO pio, uint sm) { (void)pio; (void)sm; }
+void pio_sm_restart(PIO pio, uint sm) {
+    (void)sm;
+    if (!cosim_active()) return;
+    cosim_restart(pio->id == 0 ? &g_drive->cosim.read_emu : &g_drive->cosim.write_emu);
+}
 
 void pio_sm_clear_fifos(PIO pio, uint sm) {
-    (void)pio; (void)sm;
+    (void)sm;
     if (g_drive) {
-        pio_sim_load_track();
+        if (pio->id == 0) pio_sim_load_track();
+        if (g_drive->cosim.enabled) {
+            pio_sim_cosim_t *c = &g_drive->cosim;
+            if (pio->id == 0) {
+                cosim_clear_fifos(&c->read_emu);
+                c->flux_left = 0;
+                c->index_left = 0;
+            } else {
+                cosim_clear_fifos(&c->write_emu);
+            }
+        }
     }
 }
 
 void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
-    (void)pio; (void)sm; (void)enabled;
+    (void)sm;
+    if (!cosim_active()) return;
+    if (pio->id == 0) {
+        g_drive->cosim.read_enabled = enabled;
+    } else {
+        g_drive->cosim.write_enabled = enabled;
+    }
 }
 
 void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t values, uint32_t mask) {
@@ -204,6 +634,12 @@ void pio_gpio_init(PIO pio, uint pin) { (void)pio; (void)pin; }
 
 bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
     (void)pio; (void)sm;
+    if (cosim_active()) {
+        pio_sim_cosim_t *c = &g_drive->cosim;
+        bool empty = pio_emu_rx_empty(&c->read_emu);
+        cosim_poll(c, empty);
+        return empty;
+    }
     if (!g_drive || !g_drive->read_buf) return true;
     return g_drive->read_count == 0;
 }
@@ -213,10 +649,12 @@ static uint16_t pio_sim_next_sample(void) {
         return (0x7FFF << 1) | 1;
 
     if (g_drive->read_pos >= g_drive->read_count)
-        g_drive->read_pos = 0;
+        pio_sim_next_rev();
 
     uint16_t delta = g_drive->read_buf[g_drive->read_pos++];
+    g_drive->index_synced = false;
     g_drive->counter -= delta;
+    g_drive->revolutions += 1.0 / g_drive->read_count;
 
     g_drive->flux_in_rev++;
 
@@ -232,6 +670,17 @@ static uint16_t pio_sim_next_sample(void) {
 
 uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
     (void)pio; (void)sm;
+    if (cosim_active()) {
+        pio_sim_cosim_t *c = &g_drive->cosim;
+        while (pio_emu_rx_empty(&c->read_emu)) {
+            cosim_idle(c, COSIM_READ_TICKS);
+        }
+        uint32_t word = pio_emu_rx_get(&c->read_emu);
+        c->stats.rx_words++;
+        c->stats.rx_stall_cycles = c->read_emu.rx_stall_cycles;
+        cosim_cpu(c, c->cost.read_word_cycles);
+        return word;
+    }
     uint16_t lo = pio_sim_next_sample();
     uint16_t hi = pio_sim_next_sample();
     return ((uint32_t)hi << 16) | lo;
@@ -239,6 +688,12 @@ uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
 
 bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm) {
     (void)pio; (void)sm;
+    if (cosim_active()) {
+        pio_sim_cosim_t *c = &g_drive->cosim;
+        bool empty = c->write_emu.tx_count == 0;
+        cosim_poll(c, !empty);
+        return empty;
+    }
     return true;
 }
 
@@ -246,6 +701,21 @@ void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
     (void)pio; (void)sm;
     if (!g_drive) return;
 
+    if (g_drive->cosim.enabled) {
+        pio_sim_cosim_t *c = &g_drive->cosim;
+        while (pio_emu_tx_full(&c->write_emu)) {
+            c->write_primed = true;
+            cosim_idle(c, COSIM_READ_TICKS);
+        }
+        if ((c->write_primed || c->write_stalls > 0) &&
+            c->write_emu.tx_count < c->stats.tx_low) {
+            c->stats.tx_low = c->write_emu.tx_count;
+        }
+        pio_emu_tx_put(&c->write_emu, data);
+        c->stats.tx_words++;
+        cosim_cpu(c, c->cost.write_word_cycles);
+    }
+
     if (g_drive->write_capture_count >= g_drive->write_capture_capacity) {
         uint32_t cap = g_drive->write_capture_capacity ? g_drive->write_capture_capacity * 2 : 4096;
         g_drive->write_capture = realloc(g_drive->write_capture, cap);
@@ -4,14 +4,87 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "pio_emu.h"
 
 #define PIO_SIM_MAX_FLUX 200000
+#define PIO_SIM_MAX_REVS 5
+#define PIO_SIM_MAX_WEAK 8
 
 typedef struct {
-    uint16_t *deltas;
-    uint32_t count;
+    uint16_t *revs[PIO_SIM_MAX_REVS];
+    uint32_t counts[PIO_SIM_MAX_REVS];
+    uint8_t num_revs;
 } pio_sim_track_t;
 
+typedef struct {
+    uint8_t track;
+    uint8_t side;
+    uint16_t start_permille;
+    uint16_t length_permille;
+    uint8_t spread;
+    uint16_t dropout_ppm;
+    uint8_t approach_steps;
+    bool write_heals;
+} pio_sim_weak_t;
+
+typedef struct {
+    bool enabled;
+    uint32_t seed;
+    int16_t jitter;
+    int16_t peak_shift_outer;
+    int16_t peak_shift_inner;
+    int32_t wobble_ppm;
+    uint8_t wobble_cycles;
+    pio_sim_weak_t weak[PIO_SIM_MAX_WEAK];
+    uint8_t weak_count;
+} pio_sim_media_t;
+
+typedef struct {
+    uint32_t read_word_cycles;
+    uint32_t write_word_cycles;
+    uint32_t poll_cycles;
+} pio_sim_cpu_cost_t;
+
+typedef struct {
+    uint64_t cpu_busy_cycles;
+    uint64_t cpu_wait_cycles;
+    uint32_t rx_words;
+    uint8_t rx_peak;
+    uint64_t rx_stall_cycles;
+    uint32_t tx_words;
+    uint8_t tx_low;
+    uint32_t tx_underruns;
+} pio_sim_cosim_stats_t;
+
+typedef struct {
+    bool enabled;
+    pio_sim_cpu_cost_t cost;
+    pio_sim_cosim_stats_t stats;
+    uint32_t cpu_ticks;
+    uint64_t now;
+    uint64_t pio_time;
+    uint8_t write_phase;
+    uint64_t wait_ticks;
+
+    pio_emu_t read_emu;
+    bool read_enabled;
+    uint32_t flux_left;
+    uint8_t pulse_left;
+    uint32_t index_left;
+
+    pio_emu_t write_emu;
+    bool write_enabled;
+    bool write_stalled;
+    bool write_primed;
+    uint32_t write_stalls;
+    bool have_edge;
+    uint64_t last_edge;
+    uint64_t stall_start;
+    uint16_t *edges;
+    uint32_t edge_count;
+    uint32_t edge_capacity;
+} pio_sim_cosim_t;
+
 typedef struct {
     pio_sim_track_t tracks[80][2];
 
@@ -21,25 +94,43 @@ typedef struct {
     bool selected;
     bool write_protected;
     bool step_direction_inward;
+    bool last_step_inward;
+    uint8_t approach;
 
-    uint16_t *read_buf;
+    pio_sim_media_t media;
+    uint16_t *media_buf;
+    uint32_t media_capacity;
+    uint32_t rev_seq;
+    double revolutions;
+
+    const uint16_t *read_buf;
     uint32_t read_count;
     uint32_t read_pos;
     uint16_t counter;
     bool index_state;
     uint32_t flux_in_rev;
 
+    bool index_synced;
+    uint64_t write_angle;
+
     uint8_t *write_capture;
     uint32_t write_capture_count;
     uint32_t write_capture_capacity;
 
     uint32_t index_poll_count;
     int fault_writes_remaining;
+
+    pio_sim_cosim_t cosim;
 } pio_sim_drive_t;
 
 void pio_sim_init(pio_sim_drive_t *drive);
 void pio_sim_free(pio_sim_drive_t *drive);
 bool pio_sim_load_scp(pio_sim_drive_t *drive, uint8_t *scp_data, size_t scp_size);
 void pio_sim_install(pio_sim_drive_t *drive);
+void pio_sim_set_media(pio_sim_drive_t *drive, const pio_sim_media_t *media);
+
+void pio_sim_enable_cosim(pio_sim_drive_t *drive, const pio_sim_cpu_cost_t *cost);
+void pio_sim_reset_cosim_stats(pio_sim_drive_t *drive);
+void pio_sim_print_cosim_stats(const pio_sim_drive_t *drive);
 
 #endif
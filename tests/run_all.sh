@@ -9,6 +9,7 @@ cmake --build build --parallel > /dev/null 2>&1
 cd build
 
 ./test_lru
+./test_parity
 ./test_mfm
 ./test_fat12
 ./test_f12
@@ -25,3 +26,7 @@ done
 ./test_pio_sim
 ./test_pio_emu
 ./test_write_verify
+./test_pio_cosim
+./test_pio_media
+./test_drive_emu
+./test_image
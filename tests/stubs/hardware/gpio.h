@@ -9,10 +9,16 @@ typedef unsigned int uint;
 #define GPIO_IN 0
 #define GPIO_OUT 1
 
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+
 void gpio_init(uint pin);
 void gpio_set_dir(uint pin, bool out);
 void gpio_pull_up(uint pin);
 void gpio_put(uint pin, bool value);
 bool gpio_get(uint pin);
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled);
+uint32_t gpio_get_irq_event_mask(uint pin);
+void gpio_acknowledge_irq(uint pin, uint32_t events);
 
 #endif
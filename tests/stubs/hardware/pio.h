@@ -34,6 +34,7 @@ void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin, uint count, bool
 void pio_gpio_init(PIO pio, uint pin);
 bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
 bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
 uint32_t pio_sm_get_blocking(PIO pio, uint sm);
 void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
 
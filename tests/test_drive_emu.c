@@ -0,0 +1,276 @@
+#include "test.h"
+#include "drive_emu_sim.h"
+#include "../src/drive_emu.h"
+#include "../src/mfm_encode.h"
+#include "../src/crc.h"
+
+#define PIN_INDEX 1
+#define PIN_TRACK0 2
+#define PIN_WRITE_PROTECT 3
+#define PIN_READ_DATA 4
+#define PIN_DISK_CHANGE 5
+#define PIN_DRIVE_SELECT 6
+#define PIN_MOTOR_ENABLE 7
+#define PIN_DIRECTION 8
+#define PIN_STEP 9
+#define PIN_WRITE_DATA 10
+#define PIN_WRITE_GATE 11
+#define PIN_SIDE_SELECT 12
+
+static const drive_emu_sim_cost_t cost = {
+    .poll_cycles = 400,
+    .encode_value_cycles = 40,
+};
+
+static uint8_t image[FLOPPY_TRACKS][2][SECTORS_PER_TRACK][SECTOR_SIZE];
+static uint32_t image_writes;
+static drive_emu_t emu;
+static drive_emu_sim_t sim;
+static uint8_t pulses[100000];
+
+static uint8_t pattern(uint8_t track, uint8_t side, uint8_t sector_n, int i) {
+    return (uint8_t)(track * 3 + side * 7 + sector_n * 11 + i);
+}
+
+static bool image_read(void *ctx, uint8_t track, uint8_t side, uint8_t sector_n, uint8_t *data) {
+    (void)ctx;
+    memcpy(data, image[track][side][sector_n - 1], SECTOR_SIZE);
+    return true;
+}
+
+static bool image_write(void *ctx, uint8_t track, uint8_t side, uint8_t sector_n, const uint8_t *data) {
+    (void)ctx;
+    memcpy(image[track][side][sector_n - 1], data, SECTOR_SIZE);
+    image_writes++;
+    return true;
+}
+
+static void setup(bool write_protected) {
+    for (int t = 0; t < FLOPPY_TRACKS; t++) {
+        for (int h = 0; h < 2; h++) {
+            for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+                for (int i = 0; i < SECTOR_SIZE; i++) image[t][h][s][i] = pattern(t, h, s + 1, i);
+            }
+        }
+    }
+    image_writes = 0;
+
+    memset(&emu, 0, sizeof(emu));
+    emu.pins.index = PIN_INDEX;
+    emu.pins.track0 = PIN_TRACK0;
+    emu.pins.write_protect = PIN_WRITE_PROTECT;
+    emu.pins.read_data = PIN_READ_DATA;
+    emu.pins.disk_change = PIN_DISK_CHANGE;
+    emu.pins.drive_select = PIN_DRIVE_SELECT;
+    emu.pins.motor_enable = PIN_MOTOR_ENABLE;
+    emu.pins.direction = PIN_DIRECTION;
+    emu.pins.step = PIN_STEP;
+    emu.pins.write_data = PIN_WRITE_DATA;
+    emu.pins.write_gate = PIN_WRITE_GATE;
+    emu.pins.side_select = PIN_SIDE_SELECT;
+
+    drive_emu_sim_init(&sim, &emu, &cost);
+    drive_emu_init(&emu);
+    drive_emu_image_t img = { .read = image_read, .write = image_write, .ctx = NULL };
+    drive_emu_change_disk(&emu, img, write_protected);
+
+    drive_emu_sim_set(&sim, PIN_DRIVE_SELECT, false);
+    drive_emu_sim_set(&sim, PIN_MOTOR_ENABLE, false);
+}
+
+static bool sectors_match(uint8_t track, uint8_t side) {
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        if (memcmp(sim.seen[s].data, image[track][side][s], SECTOR_SIZE) != 0) return false;
+    }
+    return true;
+}
+
+static size_t encode_data_field(const uint8_t *data) {
+    mfm_encode_t enc;
+    mfm_encode_init(&enc, pulses, sizeof(pulses));
+    mfm_encode_gap(&enc, 22);
+    mfm_encode_sync(&enc);
+    uint8_t field[1 + SECTOR_SIZE + 2];
+    field[0] = MFM_DATA_MARK;
+    memcpy(field + 1, data, SECTOR_SIZE);
+    uint16_t crc = crc16_mfm(field, 1 + SECTOR_SIZE);
+    field[1 + SECTOR_SIZE] = crc >> 8;
+    field[2 + SECTOR_SIZE] = crc & 0xFF;
+    mfm_encode_bytes(&enc, field, sizeof(field));
+    mfm_encode_gap(&enc, 4);
+    return enc.pos;
+}
+
+TEST(test_stream_track0_index_timing) {
+    setup(false);
+
+    drive_emu_sim_run_ms(&sim, 650);
+
+    printf("\n    %u revolutions, %u sectors decoded, %u crc errors, %u underruns\n    ",
+           emu.stats.revolutions, sim.sectors_decoded, sim.crc_errors, sim.underruns);
+
+    ASSERT_EQ(drive_emu_sim_seen_count(&sim, 0, 0), SECTORS_PER_TRACK);
+    ASSERT(sectors_match(0, 0));
+    ASSERT_EQ(sim.crc_errors, 0);
+    ASSERT_EQ(sim.underruns, 0);
+    ASSERT(sim.index_count >= 3);
+
+    for (uint32_t i = 1; i < sim.index_count; i++) {
+        double ms = (double)(sim.index_times[i] - sim.index_times[i - 1]) * 1000.0 / DRIVE_EMU_SIM_TICK_HZ;
+        printf("index period %.3f ms\n    ", ms);
+        ASSERT(ms > 198.0 && ms < 202.0);
+    }
+
+    ASSERT(!drive_emu_sim_output(&sim, PIN_TRACK0));
+    ASSERT(!drive_emu_sim_output(&sim, PIN_DISK_CHANGE));
+    ASSERT(drive_emu_sim_output(&sim, PIN_WRITE_PROTECT));
+}
+
+TEST(test_deselected_outputs_float) {
+    setup(true);
+    drive_emu_sim_set(&sim, PIN_DRIVE_SELECT, true);
+    drive_emu_sim_run_ms(&sim, 250);
+
+    ASSERT(drive_emu_sim_output(&sim, PIN_TRACK0));
+    ASSERT(drive_emu_sim_output(&sim, PIN_WRITE_PROTECT));
+    ASSERT(drive_emu_sim_output(&sim, PIN_DISK_CHANGE));
+    ASSERT_EQ(sim.index_count, 0);
+    ASSERT_EQ(sim.sectors_decoded, 0);
+
+    drive_emu_sim_set(&sim, PIN_DRIVE_SELECT, false);
+    drive_emu_sim_run_ms(&sim, 10);
+    ASSERT(!drive_emu_sim_output(&sim, PIN_WRITE_PROTECT));
+}
+
+TEST(test_seek_and_side_keep_streaming) {
+    setup(false);
+    drive_emu_sim_run_ms(&sim, 50);
+
+    drive_emu_sim_step(&sim, true, 40);
+    ASSERT_EQ(emu.cylinder, 40);
+    ASSERT_EQ(emu.stats.steps, 40);
+    ASSERT(drive_emu_sim_output(&sim, PIN_TRACK0));
+    ASSERT(drive_emu_sim_output(&sim, PIN_DISK_CHANGE));
+
+    drive_emu_sim_set(&sim, PIN_SIDE_SELECT, false);
+    drive_emu_sim_run_ms(&sim, 1);
+    drive_emu_sim_clear_seen(&sim);
+    uint32_t underruns = sim.underruns;
+    drive_emu_sim_run_ms(&sim, 220);
+
+    ASSERT_EQ(drive_emu_sim_seen_count(&sim, 40, 1), SECTORS_PER_TRACK);
+    ASSERT(sectors_match(40, 1));
+    ASSERT_EQ(sim.underruns, underruns);
+
+    drive_emu_sim_step(&sim, false, 45);
+    ASSERT_EQ(emu.cylinder, 0);
+    ASSERT(!drive_emu_sim_output(&sim, PIN_TRACK0));
+}
+
+TEST(test_short_step_pulse_is_latched) {
+    setup(false);
+    drive_emu_sim_run_ms(&sim, 50);
+
+    uint32_t low_reads = sim.low_reads[PIN_STEP];
+    drive_emu_sim_step(&sim, true, 5);
+    ASSERT_EQ(emu.cylinder, 5);
+    ASSERT_EQ(emu.stats.steps, 5);
+    ASSERT_EQ(sim.low_reads[PIN_STEP], low_reads);
+
+    drive_emu_sim_set(&sim, PIN_DRIVE_SELECT, true);
+    drive_emu_sim_run_ms(&sim, 1);
+    drive_emu_sim_step(&sim, true, 2);
+    drive_emu_sim_set(&sim, PIN_DRIVE_SELECT, false);
+    drive_emu_sim_run_ms(&sim, 1);
+    ASSERT_EQ(emu.cylinder, 5);
+}
+
+TEST(test_capture_data_field_write) {
+    setup(false);
+    drive_emu_sim_run_ms(&sim, 20);
+
+    uint8_t data[SECTOR_SIZE];
+    for (int i = 0; i < SECTOR_SIZE; i++) data[i] = (uint8_t)(0xA5 ^ (i * 13));
+    size_t n = encode_data_field(data);
+    drive_emu_sim_write(&sim, pulses, n, 7);
+    drive_emu_sim_run_ms(&sim, 220);
+
+    ASSERT(!sim.wr_active);
+    ASSERT_EQ(emu.stats.sectors_written, 1);
+    ASSERT_EQ(emu.stats.write_errors, 0);
+    ASSERT_MEM_EQ(image[0][0][6], data, SECTOR_SIZE);
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        if (s == 6) continue;
+        ASSERT_EQ(image[0][0][s][0], pattern(0, 0, s + 1, 0));
+    }
+
+    drive_emu_sim_clear_seen(&sim);
+    drive_emu_sim_run_ms(&sim, 220);
+    ASSERT_EQ(drive_emu_sim_seen_count(&sim, 0, 0), SECTORS_PER_TRACK);
+    ASSERT_MEM_EQ(sim.seen[6].data, data, SECTOR_SIZE);
+}
+
+TEST(test_capture_format_track) {
+    setup(false);
+    drive_emu_sim_step(&sim, true, 5);
+    drive_emu_sim_run_ms(&sim, 20);
+
+    static track_t t;
+    t.track = 5;
+    t.side = 0;
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        t.sectors[s].track = 5;
+        t.sectors[s].side = 0;
+        t.sectors[s].sector_n = s + 1;
+        t.sectors[s].size_code = 2;
+        t.sectors[s].valid = true;
+        memset(t.sectors[s].data, 0xF6, SECTOR_SIZE);
+    }
+    mfm_encode_t enc;
+    mfm_encode_init(&enc, pulses, sizeof(pulses));
+    size_t n = mfm_encode_track(&enc, &t);
+    ASSERT(!enc.overflow);
+
+    drive_emu_sim_write(&sim, pulses, n, -1);
+    drive_emu_sim_run_ms(&sim, 450);
+
+    ASSERT(!sim.wr_active);
+    ASSERT_EQ(emu.stats.sectors_written, SECTORS_PER_TRACK);
+    ASSERT_EQ(emu.stats.write_errors, 0);
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        ASSERT_EQ(image[5][0][s][0], 0xF6);
+        ASSERT_EQ(image[5][0][s][SECTOR_SIZE - 1], 0xF6);
+    }
+    ASSERT_EQ(image[5][1][0][0], pattern(5, 1, 1, 0));
+}
+
+TEST(test_write_protect_rejects_capture) {
+    setup(true);
+    drive_emu_sim_run_ms(&sim, 20);
+    ASSERT(!drive_emu_sim_output(&sim, PIN_WRITE_PROTECT));
+
+    uint8_t data[SECTOR_SIZE];
+    memset(data, 0x00, sizeof(data));
+    size_t n = encode_data_field(data);
+    drive_emu_sim_write(&sim, pulses, n, 3);
+    drive_emu_sim_run_ms(&sim, 220);
+
+    ASSERT_EQ(emu.stats.sectors_written, 0);
+    ASSERT_EQ(emu.stats.write_errors, 1);
+    ASSERT_EQ(image_writes, 0);
+    ASSERT_EQ(image[0][0][2][0], pattern(0, 0, 3, 0));
+}
+
+int main(void) {
+    printf("=== Drive Emulation Tests ===\n\n");
+
+    RUN_TEST(test_stream_track0_index_timing);
+    RUN_TEST(test_deselected_outputs_float);
+    RUN_TEST(test_seek_and_side_keep_streaming);
+    RUN_TEST(test_short_step_pulse_is_latched);
+    RUN_TEST(test_capture_data_field_write);
+    RUN_TEST(test_capture_format_track);
+    RUN_TEST(test_write_protect_rejects_capture);
+
+    TEST_RESULTS();
+}
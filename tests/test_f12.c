@@ -571,6 +571,255 @@ TEST(test_list_callback_proper) {
   f12_unmount(&fs);
 }
 
+static bool archive_parity_consistent(uint8_t level, uint8_t first) {
+  for (int t = 0; t < first * 2; t++) {
+    const uint8_t *data[SECTORS_PER_TRACK];
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) data[i] = vdisk.data[t * SECTORS_PER_TRACK + i];
+    uint8_t p[SECTOR_SIZE], q[SECTOR_SIZE];
+    parity_encode(data, SECTORS_PER_TRACK, SECTOR_SIZE, p, q);
+    int lba = first * 2 * SECTORS_PER_TRACK + t * level;
+    if (memcmp(vdisk.data[lba], p, SECTOR_SIZE) != 0) return false;
+    if (level > 1 && memcmp(vdisk.data[lba + 1], q, SECTOR_SIZE) != 0) return false;
+  }
+  return true;
+}
+
+static int write_pattern_file(f12_t *fs, const char *name, uint32_t size, uint8_t seed) {
+  f12_file_t *f = f12_open(fs, name, "w");
+  if (!f) return -1;
+  uint8_t buf[512];
+  for (uint32_t off = 0; off < size; off += sizeof(buf)) {
+    for (int i = 0; i < 512; i++) buf[i] = (uint8_t)((off + i) * seed + (off >> 9));
+    uint32_t n = size - off < sizeof(buf) ? size - off : sizeof(buf);
+    if (f12_write(f, buf, n) != (int)n) return -1;
+  }
+  return f12_close(f) == F12_OK ? 0 : -1;
+}
+
+static bool check_pattern_file(f12_t *fs, const char *name, uint32_t size, uint8_t seed) {
+  f12_file_t *f = f12_open(fs, name, "r");
+  if (!f) return false;
+  uint8_t buf[512];
+  bool ok = true;
+  for (uint32_t off = 0; off < size && ok; off += sizeof(buf)) {
+    uint32_t n = size - off < sizeof(buf) ? size - off : sizeof(buf);
+    if (f12_read(f, buf, n) != (int)n) ok = false;
+    for (uint32_t i = 0; i < n && ok; i++) {
+      if (buf[i] != (uint8_t)((off + i) * seed + (off >> 9))) ok = false;
+    }
+  }
+  f12_close(f);
+  return ok;
+}
+
+static int lost_lbas[4];
+static int lost_count;
+
+static bool lossy_read(void *ctx, sector_t *sector) {
+  int lba = vdisk_lba(sector->track, sector->side, sector->sector_n);
+  for (int i = 0; i < lost_count; i++) {
+    if (lost_lbas[i] == lba) {
+      sector->valid = false;
+      return false;
+    }
+  }
+  return vdisk_read(ctx, sector);
+}
+
+TEST(test_archive_parity_follows_writes) {
+  vdisk_init(&vdisk);
+
+  f12_t fs;
+  memset(&fs, 0, sizeof(fs));
+  fs.io = vdisk_f12_io();
+  f12_format(&fs, "ARCHIVE", false);
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+
+  ASSERT_EQ(f12_archive_cylinders(1), 5);
+  ASSERT_EQ(f12_archive_cylinders(2), 9);
+  ASSERT_EQ(f12_archive_cylinders(3), 0);
+  ASSERT_EQ(f12_archive_enable(&fs, 3), F12_ERR_INVALID);
+
+  uint8_t boot[SECTOR_SIZE];
+  memcpy(boot, vdisk.data[0], SECTOR_SIZE);
+  ASSERT_EQ(f12_archive_enable(&fs, 2), F12_OK);
+  ASSERT_EQ(fs.archive.first_cylinder, 71);
+  ASSERT(archive_parity_consistent(2, 71));
+  ASSERT_MEM_EQ(vdisk.data[0], boot, SECTOR_SIZE);
+  ASSERT_MEM_EQ(vdisk.data[VDISK_TOTAL_SECTORS - 1], F12_PARITY_MAGIC, 6);
+
+  ASSERT_EQ(write_pattern_file(&fs, "A.BIN", 30000, 3), 0);
+  ASSERT_EQ(write_pattern_file(&fs, "B.BIN", 5000, 5), 0);
+  ASSERT_EQ(fs.archive.pending_count, 0);
+  ASSERT(archive_parity_consistent(2, 71));
+
+  ASSERT_EQ(f12_delete(&fs, "A.BIN"), F12_OK);
+  ASSERT_EQ(write_pattern_file(&fs, "C.BIN", 12000, 7), 0);
+  ASSERT(archive_parity_consistent(2, 71));
+
+  uint16_t entry;
+  uint16_t cluster = 71 * 2 * SECTORS_PER_TRACK - fs.fat.data_start_sector + 2;
+  ASSERT_EQ(fat12_get_entry(&fs.fat, cluster, &entry), FAT12_OK);
+  ASSERT_EQ(entry, 0xFF7);
+  ASSERT_EQ(fat12_get_entry(&fs.fat, fs.fat.total_clusters + 1, &entry), FAT12_OK);
+  ASSERT_EQ(entry, 0xFF7);
+  ASSERT_EQ(fat12_get_entry(&fs.fat, cluster - 1, &entry), FAT12_OK);
+  ASSERT_EQ(entry, 0);
+
+  f12_unmount(&fs);
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(fs.archive.level, 2);
+  ASSERT(check_pattern_file(&fs, "C.BIN", 12000, 7));
+  f12_unmount(&fs);
+}
+
+TEST(test_archive_rebuilds_lost_sectors) {
+  vdisk_init(&vdisk);
+
+  f12_t fs;
+  memset(&fs, 0, sizeof(fs));
+  fs.io = vdisk_f12_io();
+  f12_format(&fs, "ARCHIVE", false);
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(write_pattern_file(&fs, "PLAIN.BIN", 20000, 9), 0);
+  f12_unmount(&fs);
+
+  f12_io_t io = vdisk_f12_io();
+  io.read = lossy_read;
+  lost_lbas[0] = 40;
+  lost_count = 1;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(!check_pattern_file(&fs, "PLAIN.BIN", 20000, 9));
+  f12_unmount(&fs);
+
+  lost_count = 0;
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(f12_archive_enable(&fs, 1), F12_OK);
+  f12_unmount(&fs);
+
+  lost_count = 1;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(check_pattern_file(&fs, "PLAIN.BIN", 20000, 9));
+  ASSERT_EQ(fs.archive.stats.rebuilt, 1);
+  f12_unmount(&fs);
+
+  lost_lbas[1] = 45;
+  lost_count = 2;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(!check_pattern_file(&fs, "PLAIN.BIN", 20000, 9));
+  ASSERT(fs.archive.stats.rebuild_fails > 0);
+  f12_unmount(&fs);
+
+  lost_count = 0;
+  vdisk_init(&vdisk);
+  memset(&fs, 0, sizeof(fs));
+  fs.io = vdisk_f12_io();
+  f12_format(&fs, "ARCHIVE", false);
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(f12_archive_enable(&fs, 2), F12_OK);
+  ASSERT_EQ(write_pattern_file(&fs, "PLAIN.BIN", 20000, 9), 0);
+  f12_unmount(&fs);
+
+  lost_count = 2;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(check_pattern_file(&fs, "PLAIN.BIN", 20000, 9));
+  ASSERT_EQ(fs.archive.stats.rebuilt, 2);
+  f12_unmount(&fs);
+  lost_count = 0;
+}
+
+TEST(test_archive_refuses_stale_parity) {
+  vdisk_init(&vdisk);
+
+  f12_t fs;
+  memset(&fs, 0, sizeof(fs));
+  fs.io = vdisk_f12_io();
+  f12_format(&fs, "ARCHIVE", false);
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(f12_archive_enable(&fs, 1), F12_OK);
+  ASSERT_EQ(write_pattern_file(&fs, "A.BIN", 20000, 3), 0);
+  ASSERT_EQ(vdisk.data[VDISK_TOTAL_SECTORS - 1][F12_PARITY_DIRTY_OFFSET], 0);
+
+  f12_file_t *f = f12_open(&fs, "B.BIN", "w");
+  ASSERT_NOT_NULL(f);
+  uint8_t buf[512];
+  memset(buf, 0x5A, sizeof(buf));
+  for (int i = 0; i < 40; i++) ASSERT_EQ(f12_write(f, buf, sizeof(buf)), 512);
+  ASSERT_EQ(vdisk.data[73][0], 0x5A);
+  ASSERT(fs.archive.pending_count > 0);
+  ASSERT_EQ(vdisk.data[VDISK_TOTAL_SECTORS - 1][F12_PARITY_DIRTY_OFFSET], 1);
+
+  f12_io_t io = vdisk_f12_io();
+  io.read = lossy_read;
+  lost_lbas[0] = 72;
+  lost_count = 1;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(fs.archive.stale);
+  ASSERT(!check_pattern_file(&fs, "A.BIN", 20000, 3));
+  ASSERT_EQ(fs.archive.stats.rebuilt, 0);
+  f12_unmount(&fs);
+
+  lost_count = 0;
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(f12_archive_enable(&fs, 2), F12_ERR_INVALID);
+  ASSERT_EQ(f12_archive_enable(&fs, 1), F12_OK);
+  ASSERT(!fs.archive.stale);
+  f12_unmount(&fs);
+  ASSERT_EQ(vdisk.data[VDISK_TOTAL_SECTORS - 1][F12_PARITY_DIRTY_OFFSET], 0);
+
+  lost_count = 1;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(check_pattern_file(&fs, "A.BIN", 20000, 3));
+  ASSERT_EQ(fs.archive.stats.rebuilt, 1);
+  f12_unmount(&fs);
+
+  vdisk.data[50][100] ^= 0xFF;
+  lost_lbas[0] = 45;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT(!fs.archive.stale);
+  ASSERT(!check_pattern_file(&fs, "A.BIN", 20000, 3));
+  ASSERT_EQ(fs.archive.stats.rebuilt, 0);
+  ASSERT(fs.archive.stats.rebuild_fails > 0);
+  f12_unmount(&fs);
+  lost_count = 0;
+}
+
+static bool tail_failing_write(void *ctx, track_t *track) {
+  if (track->track >= 75) return false;
+  return vdisk_write(ctx, track);
+}
+
+TEST(test_archive_enable_failure_frees_clusters) {
+  vdisk_init(&vdisk);
+
+  f12_t fs;
+  memset(&fs, 0, sizeof(fs));
+  fs.io = vdisk_f12_io();
+  f12_format(&fs, "ARCHIVE", false);
+
+  f12_io_t io = vdisk_f12_io();
+  io.write = tail_failing_write;
+  ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+  ASSERT_EQ(f12_archive_enable(&fs, 1), F12_ERR_IO);
+  ASSERT_EQ(fs.archive.level, 0);
+  ASSERT_NULL(fs.archive.pending);
+
+  uint16_t entry;
+  uint16_t cluster = 75 * 2 * SECTORS_PER_TRACK - fs.fat.data_start_sector + 2;
+  for (uint16_t c = cluster; c <= fs.fat.total_clusters + 1; c++) {
+    ASSERT_EQ(fat12_get_entry(&fs.fat, c, &entry), FAT12_OK);
+    ASSERT_EQ(entry, 0);
+  }
+  f12_unmount(&fs);
+
+  ASSERT_EQ(f12_mount(&fs, vdisk_f12_io()), F12_OK);
+  ASSERT_EQ(fs.archive.level, 0);
+  ASSERT_EQ(fat12_get_entry(&fs.fat, fs.fat.total_clusters + 1, &entry), FAT12_OK);
+  ASSERT_EQ(entry, 0);
+  ASSERT_EQ(f12_archive_enable(&fs, 1), F12_OK);
+  f12_unmount(&fs);
+}
+
 int main(void) {
   printf("=== F12 High-Level API Tests ===\n\n");
 
@@ -592,6 +841,10 @@ int main(void) {
   RUN_TEST(test_rpc_chunk_writes);
   RUN_TEST(test_strerror);
   RUN_TEST(test_list_callback_proper);
+  RUN_TEST(test_archive_parity_follows_writes);
+  RUN_TEST(test_archive_rebuilds_lost_sectors);
+  RUN_TEST(test_archive_refuses_stale_parity);
+  RUN_TEST(test_archive_enable_failure_frees_clusters);
 
   TEST_RESULTS();
 }
@@ -762,6 +762,372 @@ TEST(test_format_null_write_callback) {
   ASSERT_EQ(err, FAT12_ERR_INVALID);
 }
 
+static bool build_read_mem(void *ctx, uint32_t offset, uint8_t *buf, uint16_t len) {
+  memcpy(buf, (const uint8_t *)ctx + offset, len);
+  return true;
+}
+
+static uint8_t build_pattern(int file, uint32_t i) {
+  return (uint8_t)(file * 31 + i * 7 + (i >> 9));
+}
+
+static void build_files(fat12_build_file_t *files, uint8_t **bufs,
+                        const uint32_t *sizes, int count) {
+  static const char *names[] = {"A.BIN", "B.BIN", "C.TXT", "D.TXT", "E.DAT", "F.DAT"};
+  for (int f = 0; f < count; f++) {
+    bufs[f] = malloc(sizes[f] ? sizes[f] : 1);
+    for (uint32_t i = 0; i < sizes[f]; i++) bufs[f][i] = build_pattern(f, i);
+    files[f].name = names[f];
+    files[f].size = sizes[f];
+    files[f].read = build_read_mem;
+    files[f].ctx = bufs[f];
+  }
+}
+
+static uint16_t build_tracks_touched(uint16_t start, uint32_t size) {
+  uint16_t n = (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+  uint16_t first = fat12_build_cluster_lba(start);
+  uint16_t last = first + n - 1;
+  return last / SECTORS_PER_TRACK - first / SECTORS_PER_TRACK + 1;
+}
+
+TEST(test_build_read_back) {
+  static vdisk_t disk;
+  vdisk_init(&disk);
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+
+  const uint32_t sizes[] = {20000, 9000, 700, 100, 0, 18 * SECTOR_SIZE};
+  fat12_build_file_t files[6];
+  uint8_t *bufs[6];
+  build_files(files, bufs, sizes, 6);
+
+  ASSERT_EQ(fat12_build(io, "BUILT", files, 6, false), FAT12_OK);
+
+  fat12_t fat;
+  ASSERT_EQ(fat12_init(&fat, io), FAT12_OK);
+  ASSERT(!fat.fat_mismatch);
+
+  for (int f = 0; f < 6; f++) {
+    fat12_dirent_t entry;
+    ASSERT_EQ(fat12_find(&fat, files[f].name, &entry), FAT12_OK);
+    ASSERT_EQ(entry.size, sizes[f]);
+    ASSERT_EQ(entry.start_cluster, files[f].start_cluster);
+
+    uint16_t cluster = entry.start_cluster;
+    uint16_t n = (sizes[f] + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    for (uint16_t c = 0; c < n; c++) {
+      uint16_t next;
+      ASSERT_EQ(fat12_get_entry(&fat, cluster, &next), FAT12_OK);
+      if (c + 1 < n) ASSERT_EQ(next, cluster + 1);
+      else ASSERT(fat12_is_eof(next));
+      cluster = next;
+    }
+
+    fat12_file_t file;
+    ASSERT_EQ(fat12_open(&fat, &entry, &file), FAT12_OK);
+    uint8_t buf[1024];
+    uint32_t pos = 0;
+    int r;
+    while ((r = fat12_read(&file, buf, sizeof(buf))) > 0) {
+      for (int i = 0; i < r; i++) ASSERT_EQ(buf[i], build_pattern(f, pos + i));
+      pos += r;
+    }
+    ASSERT_EQ(pos, sizes[f]);
+    free(bufs[f]);
+  }
+}
+
+TEST(test_build_track_aligned) {
+  const uint32_t sizes[] = {36 * SECTOR_SIZE, 18 * SECTOR_SIZE, 10 * SECTOR_SIZE,
+                            3000, 600, 200};
+  fat12_build_file_t files[6];
+  uint8_t *bufs[6];
+  build_files(files, bufs, sizes, 6);
+
+  ASSERT_EQ(fat12_build_layout(files, 6, true), FAT12_OK);
+
+  for (int f = 0; f < 6; f++) {
+    uint16_t n = (sizes[f] + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    uint16_t min_tracks = (n + SECTORS_PER_TRACK - 1) / SECTORS_PER_TRACK;
+    ASSERT_EQ(build_tracks_touched(files[f].start_cluster, sizes[f]), min_tracks);
+    for (int g = 0; g < f; g++) {
+      uint16_t m = (sizes[g] + SECTOR_SIZE - 1) / SECTOR_SIZE;
+      ASSERT(files[f].start_cluster + n <= files[g].start_cluster ||
+             files[g].start_cluster + m <= files[f].start_cluster);
+    }
+    free(bufs[f]);
+  }
+
+  ASSERT(files[4].start_cluster < files[0].start_cluster);
+  ASSERT(files[5].start_cluster < files[0].start_cluster);
+}
+
+TEST(test_build_one_sweep) {
+  static vdisk_t disk;
+  vdisk_init(&disk);
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+
+  const uint32_t sizes[] = {100000, 50000, 4000};
+  fat12_build_file_t files[3];
+  uint8_t *bufs[3];
+  build_files(files, bufs, sizes, 3);
+
+  ASSERT_EQ(fat12_build(io, NULL, files, 3, false), FAT12_OK);
+  uint16_t clusters = (100000 + 511) / 512 + (50000 + 511) / 512 + (4000 + 511) / 512;
+  int min_tracks = (33 + clusters + SECTORS_PER_TRACK - 1) / SECTORS_PER_TRACK;
+  ASSERT(disk.track_writes >= min_tracks);
+  ASSERT(disk.track_writes <= min_tracks + 2);
+
+  vdisk_init(&disk);
+  ASSERT_EQ(fat12_build(io, NULL, files, 3, true), FAT12_OK);
+  ASSERT_EQ(disk.track_writes, 160);
+
+  for (int f = 0; f < 3; f++) free(bufs[f]);
+}
+
+TEST(test_build_rejects_bad_names) {
+  static vdisk_t disk;
+  vdisk_init(&disk);
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+
+  const uint32_t sizes[] = {100, 200};
+  fat12_build_file_t files[2];
+  uint8_t *bufs[2];
+  build_files(files, bufs, sizes, 2);
+
+  static const char *bad[][2] = {
+    {"LONGNAME1.TXT", "LONGNAME2.TXT"},
+    {"A.BIN", "a.bin"},
+    {"TOOLONGNAME.BIN", "B.BIN"},
+    {"A.TEXT", "B.BIN"},
+    {"A.B.C", "B.BIN"},
+    {".BIN", "B.BIN"},
+    {"A.", "B.BIN"},
+    {"", "B.BIN"},
+    {"A B.BIN", "B.BIN"},
+    {"A*.BIN", "B.BIN"},
+  };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    files[0].name = bad[i][0];
+    files[1].name = bad[i][1];
+    ASSERT_EQ(fat12_build_layout(files, 2, false), FAT12_ERR_INVALID);
+    ASSERT_EQ(fat12_build(io, NULL, files, 2, false), FAT12_ERR_INVALID);
+  }
+  ASSERT_EQ(disk.track_writes, 0);
+
+  files[0].name = "LONGNAM1.TXT";
+  files[1].name = "B";
+  ASSERT_EQ(fat12_build(io, NULL, files, 2, false), FAT12_OK);
+  ASSERT_EQ(fat12_build_cluster_lba(2), 33);
+
+  for (int f = 0; f < 2; f++) free(bufs[f]);
+}
+
+TEST(test_build_rejects_oversized) {
+  static vdisk_t disk;
+  vdisk_init(&disk);
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+
+  const uint32_t sizes[] = {100, 200};
+  fat12_build_file_t files[2];
+  uint8_t *bufs[2];
+  build_files(files, bufs, sizes, 2);
+
+  static const uint32_t huge[] = {
+    32u * 1024 * 1024, 32u * 1024 * 1024 + SECTOR_SIZE, 2847u * SECTOR_SIZE + 1, UINT32_MAX,
+  };
+  for (size_t i = 0; i < sizeof(huge) / sizeof(huge[0]); i++) {
+    files[0].size = huge[i];
+    ASSERT_EQ(fat12_build_layout(files, 2, false), FAT12_ERR_FULL);
+    ASSERT_EQ(fat12_build(io, NULL, files, 2, false), FAT12_ERR_FULL);
+  }
+  ASSERT_EQ(disk.track_writes, 0);
+
+  files[0].size = 2000u * SECTOR_SIZE;
+  files[1].size = 848u * SECTOR_SIZE;
+  ASSERT_EQ(fat12_build_layout(files, 2, false), FAT12_ERR_FULL);
+  files[1].size = 847u * SECTOR_SIZE;
+  ASSERT_EQ(fat12_build_layout(files, 2, false), FAT12_OK);
+
+  for (int f = 0; f < 2; f++) free(bufs[f]);
+}
+
+TEST(test_build_full) {
+  const uint32_t sizes[] = {1000000, 500000};
+  fat12_build_file_t files[2];
+  uint8_t *bufs[2];
+  build_files(files, bufs, sizes, 2);
+
+  ASSERT_EQ(fat12_build_layout(files, 2, false), FAT12_ERR_FULL);
+
+  files[0].size = 2847 * SECTOR_SIZE - 600;
+  files[1].size = 100;
+  ASSERT_EQ(fat12_build_layout(files, 2, false), FAT12_OK);
+
+  for (int f = 0; f < 2; f++) free(bufs[f]);
+}
+
+typedef struct {
+  vdisk_t *disk;
+  int max_track;
+} alloc_trace_t;
+
+static bool alloc_trace_write(void *ctx, track_t *track) {
+  alloc_trace_t *t = (alloc_trace_t *)ctx;
+  if (track->track > t->max_track) t->max_track = track->track;
+  return vdisk_write(t->disk, track);
+}
+
+static bool alloc_trace_read(void *ctx, sector_t *sector) {
+  alloc_trace_t *t = (alloc_trace_t *)ctx;
+  return vdisk_read(t->disk, sector);
+}
+
+static uint16_t alloc_write_file(fat12_t *fat, const char *name, uint32_t size,
+                                 uint32_t hint, uint8_t seed) {
+  fat12_writer_t writer;
+  if (fat12_open_write(fat, name, &writer) != FAT12_OK) return 0;
+  fat12_set_size_hint(&writer, hint);
+
+  uint8_t chunk[1024];
+  for (uint32_t off = 0; off < size; off += sizeof(chunk)) {
+    uint16_t len = size - off < sizeof(chunk) ? size - off : sizeof(chunk);
+    for (uint16_t i = 0; i < len; i++) chunk[i] = (uint8_t)((off + i) * 7 + seed);
+    if (fat12_write(&writer, chunk, len) != len) return 0;
+  }
+  if (fat12_close_write(&writer) != FAT12_OK) return 0;
+
+  fat12_dirent_t entry;
+  if (fat12_find(fat, name, &entry) != FAT12_OK) return 0;
+  return entry.start_cluster;
+}
+
+static bool alloc_check_file(fat12_t *fat, const char *name, uint32_t size, uint8_t seed) {
+  fat12_dirent_t entry;
+  if (fat12_find(fat, name, &entry) != FAT12_OK || entry.size != size) return false;
+  fat12_file_t file;
+  fat12_open(fat, &entry, &file);
+  uint8_t chunk[1024];
+  for (uint32_t off = 0; off < size; off += sizeof(chunk)) {
+    uint16_t len = size - off < sizeof(chunk) ? size - off : sizeof(chunk);
+    if (fat12_read(&file, chunk, len) != len) return false;
+    for (uint16_t i = 0; i < len; i++) {
+      if (chunk[i] != (uint8_t)((off + i) * 7 + seed)) return false;
+    }
+  }
+  return true;
+}
+
+static int alloc_small_write_cylinder(fat12_alloc_t policy, uint16_t *big, uint16_t *small) {
+  static vdisk_t disk;
+  vdisk_format_valid(&disk);
+  alloc_trace_t trace = { .disk = &disk };
+
+  fat12_t fat;
+  fat12_io_t io = { .read = alloc_trace_read, .write = alloc_trace_write, .ctx = &trace };
+  fat12_init(&fat, io);
+  fat.alloc_policy = policy;
+
+  *big = alloc_write_file(&fat, "BIG.BIN", 100000, 100000, 1);
+  trace.max_track = 0;
+  *small = alloc_write_file(&fat, "NOTE.TXT", 700, 700, 2);
+  if (!alloc_check_file(&fat, "BIG.BIN", 100000, 1)) return -1;
+  if (!alloc_check_file(&fat, "NOTE.TXT", 700, 2)) return -1;
+  return trace.max_track;
+}
+
+TEST(test_alloc_locality_small_near_metadata) {
+  uint16_t big, small;
+  int first_fit = alloc_small_write_cylinder(FAT12_ALLOC_FIRST_FIT, &big, &small);
+  ASSERT_EQ(big, 2);
+  ASSERT_EQ(small, 198);
+
+  int locality = alloc_small_write_cylinder(FAT12_ALLOC_LOCALITY, &big, &small);
+  ASSERT_EQ(big, 257);
+  ASSERT_EQ(small, 2);
+
+  printf("\n  Small file write reaches cylinder %d with first fit, %d with locality\n  ",
+         first_fit, locality);
+  ASSERT(first_fit >= 6);
+  ASSERT_EQ(locality, 0);
+}
+
+TEST(test_alloc_locality_rewrite_and_fallback) {
+  static vdisk_t disk;
+  vdisk_format_valid(&disk);
+
+  fat12_t fat;
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+  fat12_init(&fat, io);
+  fat.alloc_policy = FAT12_ALLOC_LOCALITY;
+
+  ASSERT_EQ(alloc_write_file(&fat, "A.TXT", 3000, 0, 3), 2);
+  ASSERT_EQ(alloc_write_file(&fat, "B.TXT", 3000, 0, 4), 8);
+  ASSERT_EQ(alloc_write_file(&fat, "A.TXT", 2500, 2500, 5), 2);
+  ASSERT_EQ(fat12_delete(&fat, "B.TXT"), FAT12_OK);
+  ASSERT_EQ(alloc_write_file(&fat, "C.TXT", 1000, 1000, 6), 7);
+
+  uint32_t huge = 2700 * SECTOR_SIZE;
+  ASSERT_EQ(alloc_write_file(&fat, "HUGE.BIN", huge, huge, 7), 257);
+  ASSERT(alloc_check_file(&fat, "HUGE.BIN", huge, 7));
+  ASSERT(alloc_check_file(&fat, "A.TXT", 2500, 5));
+  ASSERT(alloc_check_file(&fat, "C.TXT", 1000, 6));
+
+  ASSERT_EQ(fat12_delete(&fat, "HUGE.BIN"), FAT12_OK);
+  ASSERT_EQ(alloc_write_file(&fat, "BIG2.BIN", 20000, 20000, 8), 257);
+}
+
+TEST(test_alloc_locality_unhinted_large_spills) {
+  static vdisk_t disk;
+  vdisk_format_valid(&disk);
+
+  fat12_t fat;
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+  fat12_init(&fat, io);
+  fat.alloc_policy = FAT12_ALLOC_LOCALITY;
+
+  ASSERT_EQ(alloc_write_file(&fat, "BIG.BIN", 100000, 0, 1), 2);
+  uint16_t small_clusters = FAT12_SMALL_FILE_MAX / SECTOR_SIZE;
+  uint16_t next;
+  ASSERT_EQ(fat12_get_entry(&fat, 2 + small_clusters - 2, &next), FAT12_OK);
+  ASSERT_EQ(next, 2 + small_clusters - 1);
+  ASSERT_EQ(fat12_get_entry(&fat, 2 + small_clusters - 1, &next), FAT12_OK);
+  ASSERT_EQ(next, 257);
+
+  ASSERT_EQ(alloc_write_file(&fat, "NOTE.TXT", 700, 0, 2), 2 + small_clusters);
+  ASSERT(alloc_check_file(&fat, "BIG.BIN", 100000, 1));
+  ASSERT(alloc_check_file(&fat, "NOTE.TXT", 700, 2));
+}
+
+TEST(test_alloc_locality_rewrite_stays_near) {
+  static vdisk_t disk;
+  vdisk_format_valid(&disk);
+
+  fat12_t fat;
+  fat12_io_t io = { .read = vdisk_read, .write = vdisk_write, .ctx = &disk };
+  fat12_init(&fat, io);
+  fat.alloc_policy = FAT12_ALLOC_LOCALITY;
+
+  ASSERT_EQ(alloc_write_file(&fat, "LOG.TXT", 3000, 0, 1), 2);
+  ASSERT_EQ(alloc_write_file(&fat, "BIG.BIN", 20000, 20000, 2), 257);
+
+  uint32_t grown = FAT12_SMALL_FILE_MAX * 3;
+  ASSERT_EQ(alloc_write_file(&fat, "LOG.TXT", grown, 0, 3), 2);
+  uint16_t cluster = 2, next, far = 0;
+  for (uint32_t n = 0; n < grown / SECTOR_SIZE; n++) {
+    ASSERT_EQ(fat12_get_entry(&fat, cluster, &next), FAT12_OK);
+    if (cluster >= 257) far++;
+    cluster = next;
+  }
+  ASSERT_EQ(far, 0);
+  ASSERT(alloc_check_file(&fat, "LOG.TXT", grown, 3));
+
+  ASSERT_EQ(alloc_write_file(&fat, "BIG.BIN", 20000, 0, 4), 2 + grown / SECTOR_SIZE);
+  ASSERT_EQ(fat12_get_entry(&fat, 2 + grown / SECTOR_SIZE + FAT12_SMALL_FILE_MAX / SECTOR_SIZE - 1, &next), FAT12_OK);
+  ASSERT_EQ(next, 257);
+  ASSERT(alloc_check_file(&fat, "BIG.BIN", 20000, 4));
+}
+
 int main(void) {
   printf("=== FAT12 Tests ===\n\n");
 
@@ -795,5 +1161,19 @@ int main(void) {
   RUN_TEST(test_format_write_read_file);
   RUN_TEST(test_format_null_write_callback);
 
+  printf("\n--- Build Tests ---\n");
+  RUN_TEST(test_build_read_back);
+  RUN_TEST(test_build_track_aligned);
+  RUN_TEST(test_build_one_sweep);
+  RUN_TEST(test_build_rejects_bad_names);
+  RUN_TEST(test_build_rejects_oversized);
+  RUN_TEST(test_build_full);
+
+  printf("\n--- Allocation Tests ---\n");
+  RUN_TEST(test_alloc_locality_small_near_metadata);
+  RUN_TEST(test_alloc_locality_rewrite_and_fallback);
+  RUN_TEST(test_alloc_locality_unhinted_large_spills);
+  RUN_TEST(test_alloc_locality_rewrite_stays_near);
+
   TEST_RESULTS();
 }
@@ -177,6 +177,67 @@ TEST(test_synthetic_with_precomp) {
     flux_sim_close(&sim);
 }
 
+TEST(test_peak_shift_moves_transitions) {
+    uint8_t pulses[] = {29, 77, 29, 29, 53};
+    flux_sim_t sim;
+    flux_sim_from_track(&sim, pulses, sizeof(pulses));
+    flux_sim_set_peak_shift(&sim, 3);
+
+    uint16_t out[5];
+    uint32_t sum = 0;
+    for (int i = 0; i < 5; i++) {
+        ASSERT(flux_sim_next(&sim, &out[i]));
+        sum += out[i];
+    }
+    ASSERT(!flux_sim_next(&sim, &out[0]));
+
+    ASSERT_EQ(out[0], 48 + 3);
+    ASSERT_EQ(out[1], 96 - 6);
+    ASSERT_EQ(out[2], 48 + 3);
+    ASSERT_EQ(out[3], 48 + 3);
+    ASSERT_EQ(out[4], 72 - 3);
+    ASSERT_EQ(sum, 48 + 96 + 48 + 48 + 72);
+
+    flux_sim_close(&sim);
+}
+
+TEST(test_synthetic_with_peak_shift) {
+    uint8_t pulse_buf[200000];
+    mfm_encode_t enc;
+    mfm_encode_init(&enc, pulse_buf, sizeof(pulse_buf));
+
+    track_t trk = {.track = 20, .side = 0};
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        trk.sectors[s].track = 20;
+        trk.sectors[s].side = 0;
+        trk.sectors[s].sector_n = s + 1;
+        trk.sectors[s].valid = true;
+        for (int i = 0; i < SECTOR_SIZE; i++) {
+            trk.sectors[s].data[i] = (s * 11 + i * 3) & 0xFF;
+        }
+    }
+
+    mfm_encode_track(&enc, &trk);
+
+    int shifts[] = {2, 4, 6};
+    for (int i = 0; i < 3; i++) {
+        flux_sim_t sim;
+        flux_sim_from_track(&sim, pulse_buf, enc.pos);
+        flux_sim_set_peak_shift(&sim, shifts[i]);
+
+        sector_t sectors[SECTORS_PER_TRACK];
+        int found = decode_track(&sim, sectors, SECTORS_PER_TRACK);
+
+        printf("\n  Peak shift %d: %d/%d sectors  ", shifts[i], found, SECTORS_PER_TRACK);
+        if (shifts[i] <= 4) {
+            ASSERT_EQ(found, SECTORS_PER_TRACK);
+        }
+
+        flux_sim_close(&sim);
+    }
+    printf("\n  ");
+}
+
 TEST(test_adaptive_timing_with_drift) {
     uint8_t pulse_buf[8192];
     mfm_encode_t enc;
@@ -359,6 +420,8 @@ int main(void) {
     RUN_TEST(test_synthetic_with_jitter);
     RUN_TEST(test_synthetic_with_drift);
     RUN_TEST(test_synthetic_with_precomp);
+    RUN_TEST(test_peak_shift_moves_transitions);
+    RUN_TEST(test_synthetic_with_peak_shift);
     RUN_TEST(test_adaptive_timing_with_drift);
 
     printf("\n--- Real SCP Tests (System Shock disk 1) ---\n");
@@ -0,0 +1,234 @@
+#include "test.h"
+#include "image.h"
+#include <string.h>
+#include <unistd.h>
+
+#define SCP_PATH "../../system-shock-multilingual-floppy-ibm-pc/disk1.scp"
+#define DISK_BYTES (2880 * SECTOR_SIZE)
+
+static uint8_t *load_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(*size);
+    if (!buf) { fclose(f); return NULL; }
+    fread(buf, 1, *size, f);
+    fclose(f);
+    return buf;
+}
+
+static bool save_file(const char *path, const uint8_t *buf, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(buf, 1, size, f) == size;
+    fclose(f);
+    return ok;
+}
+
+static int valid_sectors(const image_track_t *t) {
+    int n = 0;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (t->track.sectors[i].valid) n++;
+    }
+    return n;
+}
+
+static uint8_t *make_pattern_img(const char *path) {
+    uint8_t *disk = malloc(DISK_BYTES);
+    for (int lba = 0; lba < 2880; lba++) {
+        for (int i = 0; i < SECTOR_SIZE; i++) {
+            disk[lba * SECTOR_SIZE + i] = (lba % 7 == 0) ? (uint8_t)lba : (uint8_t)(lba * 31 + i * 7);
+        }
+    }
+    FILE *f = fopen(path, "wb");
+    fwrite(disk, 1, DISK_BYTES, f);
+    fclose(f);
+    return disk;
+}
+
+static bool files_equal(const char *a, const char *b) {
+    size_t sa, sb;
+    uint8_t *da = load_file(a, &sa);
+    uint8_t *db = load_file(b, &sb);
+    bool eq = da && db && sa == sb && memcmp(da, db, sa) == 0;
+    free(da);
+    free(db);
+    return eq;
+}
+
+TEST(test_image_roundtrip_all_formats) {
+    uint8_t *disk = make_pattern_img("image_test_src.img");
+    image_stats_t st;
+
+    ASSERT(image_convert("image_test_src.img", IMAGE_IMG, "image_test.imd", IMAGE_IMD, 4, &st));
+    ASSERT_EQ(st.ok, 2880);
+    ASSERT(image_convert("image_test.imd", IMAGE_IMD, "image_test.hfe", IMAGE_HFE, 4, &st));
+    ASSERT_EQ(st.ok, 2880);
+    ASSERT(image_convert("image_test.hfe", IMAGE_HFE, "image_test.scp", IMAGE_SCP, 4, &st));
+    ASSERT_EQ(st.ok, 2880);
+    ASSERT(image_convert("image_test.scp", IMAGE_SCP, "image_test_out.img", IMAGE_IMG, 4, &st));
+    ASSERT_EQ(st.ok, 2880);
+    ASSERT_EQ(st.tracks, IMAGE_TRACK_COUNT);
+
+    size_t size;
+    uint8_t *out = load_file("image_test_out.img", &size);
+    ASSERT_EQ(size, DISK_BYTES);
+    ASSERT_MEM_EQ(out, disk, DISK_BYTES);
+
+    free(out);
+    free(disk);
+}
+
+TEST(test_image_imd_compresses_uniform_sectors) {
+    size_t size;
+    uint8_t *imd = load_file("image_test.imd", &size);
+    ASSERT(imd != NULL);
+    printf("\n  IMD size %zu bytes (raw %d)\n  ", size, DISK_BYTES);
+    ASSERT(size < DISK_BYTES - 380 * SECTOR_SIZE);
+    free(imd);
+}
+
+TEST(test_image_hfe_honours_track_length) {
+    size_t size;
+    uint8_t *hfe = load_file("image_test.hfe", &size);
+    ASSERT(hfe != NULL);
+    hfe[512 + 2] = IMAGE_HFE_TRACK_BYTES & 0xFF;
+    hfe[512 + 3] = IMAGE_HFE_TRACK_BYTES >> 8;
+    ASSERT(save_file("image_test_short.hfe", hfe, size));
+    free(hfe);
+
+    image_reader_t r;
+    ASSERT(image_reader_open(&r, "image_test_short.hfe", IMAGE_HFE));
+    image_track_t short_track, full_track;
+    ASSERT(image_read_track(&r, 0, 0, &short_track));
+    ASSERT(image_read_track(&r, 1, 0, &full_track));
+    image_reader_close(&r);
+
+    printf("\n  half-length track 0: %d/18 sectors, track 1: %d/18\n  ",
+           valid_sectors(&short_track), valid_sectors(&full_track));
+    ASSERT(valid_sectors(&short_track) > 0);
+    ASSERT(valid_sectors(&short_track) < SECTORS_PER_TRACK);
+    ASSERT_EQ(valid_sectors(&full_track), SECTORS_PER_TRACK);
+}
+
+TEST(test_image_imd_rejects_other_modes) {
+    size_t size;
+    uint8_t *imd = load_file("image_test.imd", &size);
+    ASSERT(imd != NULL);
+    uint8_t *eof = memchr(imd, 0x1A, size);
+    ASSERT(eof != NULL);
+    ASSERT_EQ(eof[1], 3);
+
+    image_reader_t r;
+    eof[1] = 0;
+    ASSERT(save_file("image_test_fm.imd", imd, size));
+    ASSERT(!image_reader_open(&r, "image_test_fm.imd", IMAGE_IMD));
+    eof[1] = 5;
+    ASSERT(save_file("image_test_fm.imd", imd, size));
+    ASSERT(!image_reader_open(&r, "image_test_fm.imd", IMAGE_IMD));
+    free(imd);
+}
+
+TEST(test_image_status_preserved) {
+    image_writer_t w;
+    ASSERT(image_writer_open(&w, "image_test_status.imd", IMAGE_IMD));
+    for (int idx = 0; idx < IMAGE_TRACK_COUNT; idx++) {
+        image_track_t t;
+        image_track_init(&t, idx / 2, idx % 2);
+        for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+            uint8_t data[SECTOR_SIZE];
+            for (int i = 0; i < SECTOR_SIZE; i++) data[i] = (uint8_t)(idx + s * 3 + i);
+            memcpy(t.track.sectors[s].data, data, SECTOR_SIZE);
+            t.track.sectors[s].valid = true;
+            t.status[s] = IMAGE_SECTOR_OK;
+        }
+        if (idx == 7) {
+            t.status[1] = IMAGE_SECTOR_DELETED;
+            t.status[4] = IMAGE_SECTOR_BAD_CRC;
+            t.track.sectors[4].valid = false;
+            t.status[8] = IMAGE_SECTOR_MISSING;
+            t.track.sectors[8].valid = false;
+        }
+        ASSERT(image_write_track(&w, &t));
+    }
+    ASSERT(image_writer_close(&w));
+
+    image_stats_t st;
+    ASSERT(image_convert("image_test_status.imd", IMAGE_IMD, "image_test_status.scp", IMAGE_SCP, 4, &st));
+    ASSERT(image_convert("image_test_status.scp", IMAGE_SCP, "image_test_status.hfe", IMAGE_HFE, 4, &st));
+    ASSERT(image_convert("image_test_status.hfe", IMAGE_HFE, "image_test_status2.imd", IMAGE_IMD, 4, &st));
+    ASSERT_EQ(st.ok, 2880 - 3);
+    ASSERT_EQ(st.deleted, 1);
+    ASSERT_EQ(st.bad_crc, 1);
+    ASSERT_EQ(st.missing, 1);
+
+    image_reader_t r;
+    ASSERT(image_reader_open(&r, "image_test_status2.imd", IMAGE_IMD));
+    image_track_t t;
+    ASSERT(image_read_track(&r, 3, 1, &t));
+    image_reader_close(&r);
+
+    ASSERT_EQ(t.status[0], IMAGE_SECTOR_OK);
+    ASSERT_EQ(t.status[1], IMAGE_SECTOR_DELETED);
+    ASSERT_EQ(t.status[4], IMAGE_SECTOR_BAD_CRC);
+    ASSERT_EQ(t.status[8], IMAGE_SECTOR_MISSING);
+    ASSERT_EQ(t.track.sectors[1].data[0], (uint8_t)(7 + 3));
+    ASSERT_EQ(t.track.sectors[4].data[10], (uint8_t)(7 + 12 + 10));
+}
+
+TEST(test_image_parallel_matches_serial) {
+    ASSERT(image_convert("image_test_src.img", IMAGE_IMG, "image_test_j1.scp", IMAGE_SCP, 1, NULL));
+    ASSERT(image_convert("image_test_src.img", IMAGE_IMG, "image_test_j8.scp", IMAGE_SCP, 8, NULL));
+    ASSERT(files_equal("image_test_j1.scp", "image_test_j8.scp"));
+
+    ASSERT(image_convert("image_test_j8.scp", IMAGE_SCP, "image_test_j1.hfe", IMAGE_HFE, 1, NULL));
+    ASSERT(image_convert("image_test_j8.scp", IMAGE_SCP, "image_test_j8.hfe", IMAGE_HFE, 8, NULL));
+    ASSERT(files_equal("image_test_j1.hfe", "image_test_j8.hfe"));
+}
+
+TEST(test_image_real_scp_to_img) {
+    FILE *f = fopen(SCP_PATH, "rb");
+    if (!f) {
+        printf("SKIP (no SCP file)\n  ");
+        tests_passed++;
+        return;
+    }
+    fclose(f);
+
+    image_stats_t st;
+    ASSERT(image_convert(SCP_PATH, IMAGE_SCP, "image_test_disk1.img", IMAGE_IMG, 4, &st));
+    printf("\n  disk1.scp: %u ok, %u bad crc, %u missing\n  ", st.ok, st.bad_crc, st.missing);
+    ASSERT_EQ(st.ok, 2880);
+
+    size_t size;
+    uint8_t *img = load_file("image_test_disk1.img", &size);
+    ASSERT_EQ(size, DISK_BYTES);
+    ASSERT_EQ(img[510], 0x55);
+    ASSERT_EQ(img[511], 0xAA);
+    free(img);
+}
+
+int main(void) {
+    printf("=== Image Converter Tests ===\n\n");
+
+    RUN_TEST(test_image_roundtrip_all_formats);
+    RUN_TEST(test_image_imd_compresses_uniform_sectors);
+    RUN_TEST(test_image_hfe_honours_track_length);
+    RUN_TEST(test_image_imd_rejects_other_modes);
+    RUN_TEST(test_image_status_preserved);
+    RUN_TEST(test_image_parallel_matches_serial);
+    RUN_TEST(test_image_real_scp_to_img);
+
+    const char *tmp[] = {
+        "image_test_src.img", "image_test.imd", "image_test.hfe", "image_test.scp",
+        "image_test_out.img", "image_test_status.imd", "image_test_status.scp",
+        "image_test_status.hfe", "image_test_status2.imd", "image_test_j1.scp",
+        "image_test_j8.scp", "image_test_j1.hfe", "image_test_j8.hfe", "image_test_disk1.img",
+        "image_test_short.hfe", "image_test_fm.imd",
+    };
+    for (size_t i = 0; i < sizeof(tmp) / sizeof(tmp[0]); i++) unlink(tmp[i]);
+
+    TEST_RESULTS();
+}
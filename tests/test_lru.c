@@ -307,6 +307,86 @@ TEST(test_get_or_create_eviction) {
   lru_free(lru);
 }
 
+TEST(test_offer_keeps_existing) {
+  lru_t *lru = lru_init(2, sizeof(int));
+  int v1 = 100, v2 = 200, v3 = 300, other = 999;
+
+  lru_set(lru, 1, &v1);
+  lru_set(lru, 2, &v2);
+  ASSERT_NULL(lru_offer(lru, 1, &other));
+  ASSERT_EQ(lru_count(lru), 2);
+
+  lru_set_offer_limit(lru, 1);
+  lru_get(lru, 1);
+  ASSERT_NOT_NULL(lru_offer(lru, 3, &v3));
+  ASSERT_EQ(*(int *)lru_get(lru, 1), 100);
+  ASSERT_NULL(lru_get(lru, 2));
+  ASSERT_EQ(*(int *)lru_get(lru, 3), 300);
+  ASSERT_NULL(lru_offer(NULL, 4, &v1));
+
+  lru_free(lru);
+}
+
+TEST(test_offer_only_free_slots_by_default) {
+  lru_t *lru = lru_init(2, sizeof(int));
+  int v = 1;
+
+  ASSERT_NOT_NULL(lru_offer(lru, 1, &v));
+  lru_set(lru, 2, &v);
+  ASSERT_NOT_NULL(lru_offer(lru, 3, &v));
+  ASSERT_NULL(lru_get(lru, 1));
+  ASSERT_NOT_NULL(lru_get(lru, 2));
+  ASSERT_NOT_NULL(lru_get(lru, 3));
+
+  ASSERT_NULL(lru_offer(lru, 4, &v));
+  ASSERT_NOT_NULL(lru_get(lru, 2));
+  ASSERT_NOT_NULL(lru_get(lru, 3));
+
+  lru_free(lru);
+}
+
+TEST(test_offer_sweep_keeps_hot_entries) {
+  lru_t *lru = lru_init(8, sizeof(int));
+  lru_set_offer_limit(lru, 2);
+  int v = 0;
+
+  for (uint32_t k = 1; k <= 8; k++) lru_set(lru, k, &v);
+  for (uint32_t k = 3; k <= 8; k++) lru_get(lru, k);
+
+  for (uint32_t k = 100; k < 100 + 18 * 160; k++) {
+    v = (int)k;
+    lru_offer(lru, k, &v);
+  }
+
+  ASSERT_EQ(lru_count(lru), 8);
+  ASSERT_NULL(lru_get(lru, 1));
+  ASSERT_NULL(lru_get(lru, 2));
+  for (uint32_t k = 3; k <= 8; k++) ASSERT_NOT_NULL(lru_get(lru, k));
+  ASSERT_EQ(*(int *)lru_get(lru, 100 + 18 * 160 - 1), 100 + 18 * 160 - 1);
+  ASSERT_EQ(*(int *)lru_get(lru, 100 + 18 * 160 - 2), 100 + 18 * 160 - 2);
+
+  lru_free(lru);
+}
+
+TEST(test_offered_evicted_before_used) {
+  lru_t *lru = lru_init(4, sizeof(int));
+  lru_set_offer_limit(lru, 4);
+  int v = 0;
+
+  lru_set(lru, 1, &v);
+  lru_set(lru, 2, &v);
+  lru_offer(lru, 10, &v);
+  lru_offer(lru, 11, &v);
+
+  lru_set(lru, 3, &v);
+  ASSERT_NULL(lru_get(lru, 10));
+  lru_set(lru, 4, &v);
+  ASSERT_NULL(lru_get(lru, 11));
+  for (uint32_t k = 1; k <= 4; k++) ASSERT_NOT_NULL(lru_get(lru, k));
+
+  lru_free(lru);
+}
+
 TEST(test_set_null_value) {
   lru_t *lru = lru_init(10, sizeof(int));
 
@@ -425,6 +505,10 @@ int main(void) {
   RUN_TEST(test_single_entry_cache);
   RUN_TEST(test_get_or_create);
   RUN_TEST(test_get_or_create_eviction);
+  RUN_TEST(test_offer_keeps_existing);
+  RUN_TEST(test_offer_only_free_slots_by_default);
+  RUN_TEST(test_offer_sweep_keeps_hot_entries);
+  RUN_TEST(test_offered_evicted_before_used);
   RUN_TEST(test_set_null_value);
   RUN_TEST(test_large_elem_size);
   RUN_TEST(test_direct_write_to_slot);
@@ -0,0 +1,107 @@
+#include "test.h"
+#include "../src/parity.h"
+
+#define N 18
+#define LEN 512
+
+static uint8_t shards[N][LEN];
+static uint8_t original[N][LEN];
+static uint8_t p[LEN];
+static uint8_t q[LEN];
+
+static void setup(uint32_t seed) {
+  for (int i = 0; i < N; i++) {
+    for (int k = 0; k < LEN; k++) {
+      seed = seed * 1103515245 + 12345;
+      shards[i][k] = (uint8_t)(seed >> 16);
+    }
+  }
+  memcpy(original, shards, sizeof(shards));
+
+  const uint8_t *data[N];
+  for (int i = 0; i < N; i++) data[i] = shards[i];
+  parity_encode(data, N, LEN, p, q);
+}
+
+static bool rebuild(const int *lost, int count, const uint8_t *pp, const uint8_t *qq) {
+  uint8_t *data[N];
+  bool present[N];
+  for (int i = 0; i < N; i++) {
+    data[i] = shards[i];
+    present[i] = true;
+  }
+  for (int i = 0; i < count; i++) {
+    memset(shards[lost[i]], 0xE5, LEN);
+    present[lost[i]] = false;
+  }
+  return parity_rebuild(data, N, LEN, present, pp, qq);
+}
+
+TEST(test_p_is_xor) {
+  setup(1);
+  for (int k = 0; k < LEN; k++) {
+    uint8_t x = 0;
+    for (int i = 0; i < N; i++) x ^= original[i][k];
+    ASSERT_EQ(p[k], x);
+  }
+}
+
+TEST(test_nothing_missing) {
+  setup(2);
+  ASSERT(rebuild(NULL, 0, p, NULL));
+  ASSERT_MEM_EQ(shards, original, sizeof(shards));
+}
+
+TEST(test_single_from_p) {
+  for (int lost = 0; lost < N; lost++) {
+    setup(3 + lost);
+    ASSERT(rebuild(&lost, 1, p, NULL));
+    ASSERT_MEM_EQ(shards[lost], original[lost], LEN);
+  }
+}
+
+TEST(test_single_from_q) {
+  for (int lost = 0; lost < N; lost++) {
+    setup(40 + lost);
+    ASSERT(rebuild(&lost, 1, NULL, q));
+    ASSERT_MEM_EQ(shards[lost], original[lost], LEN);
+  }
+}
+
+TEST(test_double_from_pq) {
+  for (int x = 0; x < N; x++) {
+    for (int y = x + 1; y < N; y++) {
+      setup(100 + x * N + y);
+      int lost[2] = { x, y };
+      ASSERT(rebuild(lost, 2, p, q));
+      ASSERT_MEM_EQ(shards, original, sizeof(shards));
+    }
+  }
+}
+
+TEST(test_too_many_missing) {
+  setup(7);
+  int two[2] = { 4, 9 };
+  ASSERT(!rebuild(two, 2, p, NULL));
+
+  setup(8);
+  int three[3] = { 0, 1, 2 };
+  ASSERT(!rebuild(three, 3, p, q));
+
+  setup(9);
+  int one = 5;
+  ASSERT(!rebuild(&one, 1, NULL, NULL));
+}
+
+int main(void) {
+  printf("=== Parity Tests ===\n\n");
+
+  RUN_TEST(test_p_is_xor);
+  RUN_TEST(test_nothing_missing);
+  RUN_TEST(test_single_from_p);
+  RUN_TEST(test_single_from_q);
+  RUN_TEST(test_double_from_pq);
+  RUN_TEST(test_too_many_missing);
+
+  TEST_RESULTS();
+}
@@ -0,0 +1,187 @@
+#include "test.h"
+#include "pio_sim.h"
+#include "flux_sim.h"
+#include "vdisk.h"
+#include "../src/floppy.h"
+#include "../src/fat12.h"
+#include "../src/f12.h"
+
+floppy_t *pio_sim_floppy_ref;
+
+static pio_sim_drive_t sim_drive;
+static floppy_t floppy;
+
+static void setup_floppy(void) {
+    memset(&floppy, 0, sizeof(floppy));
+    floppy.pins.index = 1;
+    floppy.pins.track0 = 2;
+    floppy.pins.write_protect = 3;
+    floppy.pins.read_data = 4;
+    floppy.pins.disk_change = 5;
+    floppy.pins.drive_select = 6;
+    floppy.pins.motor_enable = 7;
+    floppy.pins.direction = 8;
+    floppy.pins.step = 9;
+    floppy.pins.write_data = 10;
+    floppy.pins.write_gate = 11;
+    floppy.pins.side_select = 12;
+    floppy.pins.density = 13;
+
+    pio_sim_floppy_ref = &floppy;
+    floppy_init(&floppy);
+}
+
+static void setup_cosim_disk(const pio_sim_cpu_cost_t *cost) {
+    static uint8_t disk_sectors[2880][512];
+
+    vdisk_t vdisk;
+    vdisk_init(&vdisk);
+    fat12_io_t fat_io = { .read = vdisk_read, .write = vdisk_write, .ctx = &vdisk };
+    fat12_format(fat_io, "COSIM", true);
+    memcpy(disk_sectors, vdisk.data, sizeof(disk_sectors));
+
+    size_t scp_size;
+    uint8_t *scp_data = scp_encode_disk(disk_sectors, &scp_size);
+
+    pio_sim_free(&sim_drive);
+    pio_sim_init(&sim_drive);
+    pio_sim_load_scp(&sim_drive, scp_data, scp_size);
+    pio_sim_install(&sim_drive);
+
+    free(scp_data);
+
+    setup_floppy();
+    pio_sim_enable_cosim(&sim_drive, cost);
+}
+
+static f12_io_t make_floppy_io(void) {
+    return (f12_io_t){
+        .read = floppy_io_read,
+        .read_track = floppy_io_read_track,
+        .write = floppy_io_write,
+        .disk_changed = floppy_io_disk_changed,
+        .write_protected = floppy_io_write_protected,
+        .ctx = &floppy,
+    };
+}
+
+TEST(test_cosim_read_sector) {
+    setup_cosim_disk(NULL);
+
+    sector_t sector = { .track = 0, .side = 0, .sector_n = 1 };
+    ASSERT_EQ(floppy_read_sector(&floppy, &sector), FLOPPY_OK);
+    ASSERT(sector.valid);
+    ASSERT_EQ(sector.data[510], 0x55);
+    ASSERT_EQ(sector.data[511], 0xAA);
+
+    const pio_sim_cosim_stats_t *s = &sim_drive.cosim.stats;
+    pio_sim_print_cosim_stats(&sim_drive);
+    ASSERT(s->rx_words > 0);
+    ASSERT_EQ(s->rx_stall_cycles, 0);
+    ASSERT(s->rx_peak < PIO_EMU_FIFO_DEPTH);
+    ASSERT(s->cpu_wait_cycles > s->cpu_busy_cycles);
+}
+
+TEST(test_cosim_read_track) {
+    setup_cosim_disk(NULL);
+
+    track_t t = { .track = 1, .side = 1 };
+    ASSERT_EQ(floppy_read_track(&floppy, &t), FLOPPY_OK);
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        ASSERT(t.sectors[i].valid);
+    }
+
+    pio_sim_print_cosim_stats(&sim_drive);
+    ASSERT_EQ(sim_drive.cosim.stats.rx_stall_cycles, 0);
+}
+
+TEST(test_cosim_write_verify) {
+    setup_cosim_disk(NULL);
+
+    f12_t fs;
+    memset(&fs, 0, sizeof(fs));
+    ASSERT_EQ(f12_mount(&fs, make_floppy_io()), F12_OK);
+
+    f12_file_t *f = f12_open(&fs, "COSIM.TXT", "w");
+    ASSERT(f != NULL);
+    const char *msg = "Flux written by the emulated PIO state machine, fed one word at a time.";
+    int n = f12_write(f, msg, strlen(msg));
+    ASSERT_EQ(n, (int)strlen(msg));
+
+    pio_sim_reset_cosim_stats(&sim_drive);
+    ASSERT_EQ(f12_close(f), F12_OK);
+
+    const pio_sim_cosim_stats_t *s = &sim_drive.cosim.stats;
+    pio_sim_print_cosim_stats(&sim_drive);
+    ASSERT(s->tx_words > 0);
+    ASSERT_EQ(s->tx_underruns, 0);
+    ASSERT(s->tx_low > 0);
+
+    f12_unmount(&fs);
+    ASSERT_EQ(f12_mount(&fs, make_floppy_io()), F12_OK);
+
+    f = f12_open(&fs, "COSIM.TXT", "r");
+    ASSERT(f != NULL);
+    char buf[128];
+    n = f12_read(f, buf, sizeof(buf));
+    ASSERT_EQ(n, (int)strlen(msg));
+    ASSERT_MEM_EQ(buf, msg, strlen(msg));
+    f12_close(f);
+
+    f12_unmount(&fs);
+}
+
+TEST(test_cosim_slow_reader_overruns) {
+    pio_sim_cpu_cost_t slow = {
+        .read_word_cycles = 2000,
+        .write_word_cycles = 40,
+        .poll_cycles = 8,
+    };
+    setup_cosim_disk(&slow);
+
+    sector_t sector = { .track = 0, .side = 0, .sector_n = 1 };
+    ASSERT(floppy_read_sector(&floppy, &sector) != FLOPPY_OK);
+
+    const pio_sim_cosim_stats_t *s = &sim_drive.cosim.stats;
+    pio_sim_print_cosim_stats(&sim_drive);
+    ASSERT(s->rx_stall_cycles > 0);
+    ASSERT_EQ(s->rx_peak, PIO_EMU_FIFO_DEPTH);
+}
+
+TEST(test_cosim_slow_writer_underruns) {
+    pio_sim_cpu_cost_t slow = {
+        .read_word_cycles = 300,
+        .write_word_cycles = 1000,
+        .poll_cycles = 8,
+    };
+    setup_cosim_disk(&slow);
+
+    track_t t = { .track = 2, .side = 0 };
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        t.sectors[i].track = 2;
+        t.sectors[i].side = 0;
+        t.sectors[i].sector_n = i + 1;
+        t.sectors[i].size_code = 2;
+        t.sectors[i].valid = true;
+        memset(t.sectors[i].data, i, SECTOR_SIZE);
+    }
+    ASSERT(floppy_write_track(&floppy, &t) != FLOPPY_OK);
+
+    pio_sim_print_cosim_stats(&sim_drive);
+    ASSERT(sim_drive.cosim.stats.tx_underruns > 0);
+    ASSERT_EQ(sim_drive.cosim.stats.tx_low, 0);
+}
+
+int main(void) {
+    printf("=== PIO Co-simulation Tests ===\n\n");
+
+    RUN_TEST(test_cosim_read_sector);
+    RUN_TEST(test_cosim_read_track);
+    RUN_TEST(test_cosim_write_verify);
+    RUN_TEST(test_cosim_slow_reader_overruns);
+    RUN_TEST(test_cosim_slow_writer_underruns);
+
+    pio_sim_free(&sim_drive);
+
+    TEST_RESULTS();
+}
@@ -7,41 +7,6 @@
 
 #define SCP_PATH "../../system-shock-multilingual-floppy-ibm-pc/disk1.scp"
 
-#define PIO_JMP(cond, addr)        (uint16_t)((0 << 13) | ((cond) << 5) | (addr))
-#define PIO_JMP_D(cond, addr, d)   (uint16_t)((0 << 13) | ((d) << 8) | ((cond) << 5) | (addr))
-#define PIO_IN(src, bits)          (uint16_t)((2 << 13) | ((src) << 5) | (bits))
-#define PIO_OUT(dst, bits)         (uint16_t)((3 << 13) | ((dst) << 5) | (bits))
-#define PIO_PULL_BLOCK             (uint16_t)((4 << 13) | (7 << 5))
-#define PIO_SET(dst, val)          (uint16_t)((7 << 13) | ((dst) << 5) | (val))
-#define PIO_SET_D(dst, val, d)     (uint16_t)((7 << 13) | ((d) << 8) | ((dst) << 5) | (val))
-#define PIO_NOP_D(d)               (uint16_t)((5 << 13) | ((d) << 8) | (2 << 5) | 2)
-
-static const uint16_t flux_read_prog[] = {
-    PIO_JMP(JMP_X_DEC, 1),
-    PIO_JMP(JMP_PIN, 3),
-    PIO_JMP(JMP_ALWAYS, 0),
-    PIO_JMP(JMP_X_DEC, 4),
-    PIO_JMP_D(JMP_PIN, 3, 1),
-    PIO_IN(IN_PINS, 1),
-    PIO_IN(IN_X, 15),
-    PIO_JMP(JMP_X_DEC, 0),
-};
-#define FLUX_READ_LEN 8
-#define FLUX_READ_WRAP_TARGET 0
-#define FLUX_READ_WRAP 7
-
-static const uint16_t flux_write_prog[] = {
-    PIO_PULL_BLOCK,
-    PIO_OUT(OUT_X, 8),
-    PIO_SET(SET_PINS, 0),
-    PIO_NOP_D(13),
-    PIO_SET(SET_PINS, 1),
-    PIO_JMP(JMP_X_DEC, 5),
-};
-#define FLUX_WRITE_LEN 6
-#define FLUX_WRITE_WRAP_TARGET 0
-#define FLUX_WRITE_WRAP 5
-
 static uint8_t *load_file(const char *path, size_t *size) {
     FILE *f = fopen(path, "rb");
     if (!f) return NULL;
@@ -58,7 +23,7 @@ static uint8_t *load_file(const char *path, size_t *size) {
 TEST(test_flux_read_emu_basic) {
     pio_emu_t emu;
     pio_emu_init(&emu);
-    pio_emu_load(&emu, flux_read_prog, FLUX_READ_LEN,
+    pio_emu_load(&emu, pio_emu_flux_read_prog, FLUX_READ_LEN,
                  FLUX_READ_WRAP_TARGET, FLUX_READ_WRAP);
 
     emu.in_shift_right = true;
@@ -119,7 +84,7 @@ TEST(test_flux_read_emu_scp) {
 
     pio_emu_t emu;
     pio_emu_init(&emu);
-    pio_emu_load(&emu, flux_read_prog, FLUX_READ_LEN,
+    pio_emu_load(&emu, pio_emu_flux_read_prog, FLUX_READ_LEN,
                  FLUX_READ_WRAP_TARGET, FLUX_READ_WRAP);
     emu.in_shift_right = true;
     emu.autopush_threshold = 32;
@@ -192,7 +157,7 @@ TEST(test_flux_read_emu_scp) {
 TEST(test_flux_write_emu_roundtrip) {
     pio_emu_t write_emu;
     pio_emu_init(&write_emu);
-    pio_emu_load(&write_emu, flux_write_prog, FLUX_WRITE_LEN,
+    pio_emu_load(&write_emu, pio_emu_flux_write_prog, FLUX_WRITE_LEN,
                  FLUX_WRITE_WRAP_TARGET, FLUX_WRITE_WRAP);
     write_emu.out_shift_right = true;
     write_emu.autopull_threshold = 8;
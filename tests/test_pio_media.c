@@ -0,0 +1,552 @@
+#include "test.h"
+#include "pio_sim.h"
+#include "flux_sim.h"
+#include "vdisk.h"
+#include "../src/floppy.h"
+#include "../src/fat12.h"
+#include "../src/f12.h"
+#include "../src/mfm_encode.h"
+#include "hardware/pio.h"
+
+floppy_t *pio_sim_floppy_ref;
+
+static pio_sim_drive_t sim_drive;
+static floppy_t floppy;
+
+static void setup_floppy(void) {
+    memset(&floppy, 0, sizeof(floppy));
+    floppy.pins.index = 1;
+    floppy.pins.track0 = 2;
+    floppy.pins.write_protect = 3;
+    floppy.pins.read_data = 4;
+    floppy.pins.disk_change = 5;
+    floppy.pins.drive_select = 6;
+    floppy.pins.motor_enable = 7;
+    floppy.pins.direction = 8;
+    floppy.pins.step = 9;
+    floppy.pins.write_data = 10;
+    floppy.pins.write_gate = 11;
+    floppy.pins.side_select = 12;
+    floppy.pins.density = 13;
+
+    pio_sim_floppy_ref = &floppy;
+    floppy_init(&floppy);
+}
+
+static void setup_media_disk(const pio_sim_media_t *media) {
+    static uint8_t disk_sectors[2880][512];
+
+    vdisk_t vdisk;
+    vdisk_init(&vdisk);
+    fat12_io_t fat_io = { .read = vdisk_read, .write = vdisk_write, .ctx = &vdisk };
+    fat12_format(fat_io, "MEDIA", true);
+    memcpy(disk_sectors, vdisk.data, sizeof(disk_sectors));
+    for (int lba = 100; lba < 2880; lba++) {
+        for (int i = 0; i < 512; i++) disk_sectors[lba][i] = (uint8_t)(lba * 7 + i);
+    }
+
+    size_t scp_size;
+    uint8_t *scp_data = scp_encode_disk(disk_sectors, &scp_size);
+
+    pio_sim_free(&sim_drive);
+    pio_sim_init(&sim_drive);
+    pio_sim_load_scp(&sim_drive, scp_data, scp_size);
+    pio_sim_set_media(&sim_drive, media);
+    pio_sim_install(&sim_drive);
+
+    free(scp_data);
+
+    setup_floppy();
+}
+
+static int read_rev(uint16_t *out, uint32_t count) {
+    uint16_t prev = 0;
+    int n = 0;
+    while ((uint32_t)n < count) {
+        uint32_t w = pio_sm_get_blocking(pio0, 0);
+        for (int h = 0; h < 2 && (uint32_t)n < count; h++) {
+            uint16_t cnt = (h ? w >> 16 : w & 0xFFFF) >> 1;
+            out[n++] = (prev - cnt) & 0x7FFF;
+            prev = cnt;
+        }
+    }
+    return n;
+}
+
+static int read_track_count(uint8_t track, uint8_t side, double *revs) {
+    track_t t = { .track = track, .side = side };
+    double before = sim_drive.revolutions;
+    floppy_read_track(&floppy, &t);
+    *revs = sim_drive.revolutions - before;
+
+    int found = 0;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        if (t.sectors[i].valid) found++;
+    }
+    return found;
+}
+
+TEST(test_media_disabled_is_exact) {
+    setup_media_disk(NULL);
+
+    double revs;
+    ASSERT_EQ(read_track_count(10, 0, &revs), SECTORS_PER_TRACK);
+    printf("\n  Clean media: 18/18 sectors in %.2f revolutions\n  ", revs);
+    ASSERT(revs < 1.5);
+}
+
+TEST(test_media_jitter_differs_per_revolution) {
+    pio_sim_media_t media = { .enabled = true, .seed = 1, .jitter = 2 };
+    setup_media_disk(&media);
+
+    floppy_seek(&floppy, 3);
+    pio_sm_clear_fifos(pio0, 0);
+
+    uint32_t count = sim_drive.tracks[3][0].counts[0];
+    uint16_t *a = malloc(count * sizeof(uint16_t));
+    uint16_t *b = malloc(count * sizeof(uint16_t));
+    read_rev(a, count);
+    read_rev(b, count);
+
+    int differ = 0;
+    int64_t sum_a = 0, sum_b = 0;
+    for (uint32_t i = 1; i < count; i++) {
+        if (a[i] != b[i]) differ++;
+        sum_a += a[i];
+        sum_b += b[i];
+    }
+    printf("\n  %d/%u transitions differ between revolutions\n  ", differ, count);
+    ASSERT(differ > (int)count / 2);
+    ASSERT(llabs(sum_a - sum_b) < (int64_t)count / 50);
+
+    free(a);
+    free(b);
+}
+
+TEST(test_media_peak_shift_grows_inward) {
+    pio_sim_media_t media = {
+        .enabled = true, .seed = 2,
+        .peak_shift_outer = 0, .peak_shift_inner = 16,
+    };
+    setup_media_disk(&media);
+
+    uint8_t tracks[] = {0, 20, 40, 60, 79};
+    int found[5];
+    for (int i = 0; i < 5; i++) {
+        double revs;
+        found[i] = read_track_count(tracks[i], 0, &revs);
+        printf("\n  Track %2d (shift %d): %2d/18 sectors, %.2f revolutions",
+               tracks[i], tracks[i] * 16 / 79, found[i], revs);
+    }
+    printf("\n  ");
+    ASSERT_EQ(found[0], SECTORS_PER_TRACK);
+    ASSERT(found[4] < SECTORS_PER_TRACK);
+}
+
+TEST(test_media_wobble) {
+    pio_sim_media_t media = {
+        .enabled = true, .seed = 3, .jitter = 1,
+        .wobble_ppm = 20000, .wobble_cycles = 1,
+    };
+    setup_media_disk(&media);
+
+    double revs;
+    int found = read_track_count(30, 1, &revs);
+    printf("\n  2%% speed wobble: %d/18 sectors in %.2f revolutions\n  ", found, revs);
+    ASSERT_EQ(found, SECTORS_PER_TRACK);
+}
+
+TEST(test_media_weak_region_policies) {
+    pio_sim_media_t media = {
+        .enabled = true, .seed = 4, .jitter = 1,
+        .weak = {{
+            .track = 12, .side = 1,
+            .start_permille = 300, .length_permille = 400,
+            .spread = 2, .dropout_ppm = 100,
+        }},
+        .weak_count = 1,
+    };
+    setup_media_disk(&media);
+
+    double fused_revs;
+    int fused = read_track_count(12, 1, &fused_revs);
+
+    double before = sim_drive.revolutions;
+    int single = 0;
+    for (int s = 1; s <= SECTORS_PER_TRACK; s++) {
+        sector_t sector = { .track = 12, .side = 1, .sector_n = s };
+        if (floppy_read_sector(&floppy, &sector) == FLOPPY_OK) single++;
+    }
+    double single_revs = sim_drive.revolutions - before;
+
+    printf("\n  Multi-revolution track read: %d/18 sectors, %.2f revolutions", fused, fused_revs);
+    printf("\n  Sector-at-a-time reads:      %d/18 sectors, %.2f revolutions\n  ", single, single_revs);
+    ASSERT_EQ(fused, SECTORS_PER_TRACK);
+    ASSERT(fused_revs > 1.0);
+    ASSERT(fused_revs < single_revs);
+}
+
+TEST(test_media_weak_count_clamped) {
+    pio_sim_media_t media = {
+        .enabled = true, .seed = 4, .jitter = 1,
+        .weak_count = 255,
+    };
+    setup_media_disk(&media);
+    ASSERT_EQ(sim_drive.media.weak_count, PIO_SIM_MAX_WEAK);
+
+    double revs;
+    ASSERT_EQ(read_track_count(5, 0, &revs), SECTORS_PER_TRACK);
+}
+
+static void precomp_track(track_t *t, uint8_t track) {
+    memset(t, 0, sizeof(*t));
+    t->track = track;
+    for (int i = 0; i < SECTORS_PER_TRACK; i++) {
+        t->sectors[i] = (sector_t){
+            .track = track, .side = 0, .sector_n = i + 1, .size_code = 2, .valid = true,
+        };
+        for (int j = 0; j < SECTOR_SIZE; j++) t->sectors[i].data[j] = (uint8_t)(j * 13 + i * 7 + (j >> 3));
+    }
+}
+
+static void store_uncompensated(const track_t *t) {
+    static uint8_t pulses[200000];
+    static track_t plain;
+    plain = *t;
+    plain.track = 0;
+    mfm_encode_t enc;
+    mfm_encode_init(&enc, pulses, sizeof(pulses));
+    mfm_encode_track(&enc, &plain);
+
+    floppy_seek(&floppy, 0);
+    pio_sim_track_t *st = &sim_drive.tracks[t->track][t->side];
+    for (int r = 0; r < PIO_SIM_MAX_REVS; r++) {
+        free(st->revs[r]);
+        st->revs[r] = NULL;
+        st->counts[r] = 0;
+    }
+    st->revs[0] = malloc(enc.pos * sizeof(uint16_t));
+    for (size_t i = 0; i < enc.pos; i++) st->revs[0][i] = pulses[i] + MFM_PIO_OVERHEAD;
+    st->counts[0] = enc.pos;
+    st->num_revs = 1;
+}
+
+TEST(test_media_precomp_recovers_inner_write) {
+    static track_t t;
+    uint8_t track = MFM_PRECOMP_START_TRACK;
+    int16_t inner[] = {8, 12, 16};
+    int with[3], without[3];
+
+    for (int i = 0; i < 3; i++) {
+        pio_sim_media_t media = {
+            .enabled = true, .seed = 9, .jitter = 2,
+            .peak_shift_outer = 0, .peak_shift_inner = inner[i],
+        };
+        setup_media_disk(&media);
+        precomp_track(&t, track);
+
+        double revs;
+        floppy_write_track(&floppy, &t);
+        with[i] = read_track_count(track, 0, &revs);
+        store_uncompensated(&t);
+        without[i] = read_track_count(track, 0, &revs);
+        printf("\n  Track %d (shift %d): precomp %2d/18, uncompensated %2d/18",
+               track, inner[i] * track / (FLOPPY_TRACKS - 1), with[i], without[i]);
+    }
+    printf("\n  ");
+
+    ASSERT_EQ(with[0], SECTORS_PER_TRACK);
+    ASSERT_EQ(without[0], SECTORS_PER_TRACK);
+    ASSERT_EQ(with[1], SECTORS_PER_TRACK);
+    ASSERT(without[1] < SECTORS_PER_TRACK);
+    for (int i = 0; i < 3; i++) ASSERT(with[i] >= without[i]);
+}
+
+static double read_sector_revs(uint8_t track, uint8_t side, uint8_t sector_n, floppy_status_t *st) {
+    sector_t sector = { .track = track, .side = side, .sector_n = sector_n };
+    double before = sim_drive.revolutions;
+    *st = floppy_read_sector(&floppy, &sector);
+    return sim_drive.revolutions - before;
+}
+
+static const pio_sim_media_t offcenter_media = {
+    .enabled = true, .seed = 9,
+    .weak = {{
+        .track = 20, .side = 0,
+        .start_permille = 0, .length_permille = 1000,
+        .spread = 40, .dropout_ppm = 20000,
+        .approach_steps = 8,
+    }},
+    .weak_count = 1,
+};
+
+TEST(test_adaptive_offcenter_track) {
+    setup_media_disk(&offcenter_media);
+
+    double revs[4];
+    for (int i = 0; i < 4; i++) {
+        floppy_seek(&floppy, 21);
+        floppy_status_t st;
+        revs[i] = read_sector_revs(20, 0, 3 + i, &st);
+        ASSERT_EQ(st, FLOPPY_OK);
+    }
+
+    const floppy_history_t *h = floppy_track_history(&floppy, 20, 0);
+    printf("\n  Off-center track: %.2f, %.2f, %.2f, %.2f revolutions per read", revs[0], revs[1], revs[2], revs[3]);
+    printf("\n  direct %u ok / %u fail, jog10 %u ok / %u fail, %u revolutions total\n  ",
+           h->ok[FLOPPY_RECOVER_READ], h->fail[FLOPPY_RECOVER_READ],
+           h->ok[FLOPPY_RECOVER_JOG10], h->fail[FLOPPY_RECOVER_JOG10], h->total_revs);
+    ASSERT(revs[0] > 10.0);
+    ASSERT(revs[1] < 2.0);
+    ASSERT(revs[3] < 2.0);
+    ASSERT_EQ(h->fail[FLOPPY_RECOVER_READ], 1);
+    ASSERT_EQ(h->ok[FLOPPY_RECOVER_JOG10], 4);
+}
+
+TEST(test_adaptive_history_per_track) {
+    setup_media_disk(&offcenter_media);
+
+    floppy_seek(&floppy, 21);
+    floppy_status_t st;
+    read_sector_revs(20, 0, 1, &st);
+    ASSERT_EQ(st, FLOPPY_OK);
+
+    double healthy = read_sector_revs(20, 1, 1, &st);
+    ASSERT_EQ(st, FLOPPY_OK);
+    ASSERT(healthy < 2.0);
+    ASSERT_EQ(floppy_track_history(&floppy, 20, 1)->ok[FLOPPY_RECOVER_READ], 1);
+    ASSERT_EQ(floppy_track_history(&floppy, 20, 1)->ok[FLOPPY_RECOVER_JOG10], 0);
+
+    floppy_reset_history(&floppy);
+    ASSERT_EQ(floppy_track_history(&floppy, 20, 0)->ok[FLOPPY_RECOVER_JOG10], 0);
+    floppy_seek(&floppy, 21);
+    double relearn = read_sector_revs(20, 0, 2, &st);
+    ASSERT_EQ(st, FLOPPY_OK);
+    ASSERT(relearn > 10.0);
+}
+
+#define ARCHIVE_FILE_SIZE 24000
+
+static uint8_t archive_byte(uint32_t i) {
+    return (uint8_t)(i * 13 + (i >> 9));
+}
+
+static void setup_archive_disk(uint8_t level, const pio_sim_media_t *media, uint32_t size) {
+    static vdisk_t vdisk;
+    vdisk_init(&vdisk);
+    fat12_io_t fat_io = { .read = vdisk_read, .write = vdisk_write, .ctx = &vdisk };
+    fat12_format(fat_io, "ARCHIVE", true);
+
+    static f12_t build;
+    memset(&build, 0, sizeof(build));
+    f12_mount(&build, (f12_io_t){ .read = vdisk_read, .write = vdisk_write, .ctx = &vdisk });
+    if (level) f12_archive_enable(&build, level);
+    f12_file_t *f = f12_open(&build, "DATA.BIN", "w");
+    uint8_t buf[512];
+    for (uint32_t off = 0; off < size; off += sizeof(buf)) {
+        for (uint32_t i = 0; i < sizeof(buf); i++) buf[i] = archive_byte(off + i);
+        f12_write(f, buf, sizeof(buf));
+    }
+    f12_close(f);
+    f12_unmount(&build);
+
+    size_t scp_size;
+    uint8_t *scp_data = scp_encode_disk((const uint8_t (*)[512])vdisk.data, &scp_size);
+
+    pio_sim_free(&sim_drive);
+    pio_sim_init(&sim_drive);
+    pio_sim_load_scp(&sim_drive, scp_data, scp_size);
+    pio_sim_set_media(&sim_drive, media);
+    pio_sim_install(&sim_drive);
+
+    free(scp_data);
+
+    setup_floppy();
+}
+
+static bool read_archive_file(f12_t *fs, double *revs) {
+    f12_io_t io = {
+        .read = floppy_io_read,
+        .read_quick = floppy_io_read_quick,
+        .read_track = floppy_io_read_track,
+        .write = floppy_io_write,
+        .set_sink = floppy_io_set_sink,
+        .ctx = &floppy,
+    };
+    double before = sim_drive.revolutions;
+    bool ok = f12_mount(fs, io) == F12_OK;
+    f12_file_t *f = ok ? f12_open(fs, "DATA.BIN", "r") : NULL;
+    ok = f != NULL;
+    uint8_t buf[512];
+    for (uint32_t off = 0; ok && off < ARCHIVE_FILE_SIZE; off += sizeof(buf)) {
+        ok = f12_read(f, buf, sizeof(buf)) == (int)sizeof(buf);
+        for (uint32_t i = 0; ok && i < sizeof(buf); i++) ok = buf[i] == archive_byte(off + i);
+    }
+    if (f) f12_close(f);
+    *revs = sim_drive.revolutions - before;
+    return ok;
+}
+
+TEST(test_adaptive_budget_per_operation) {
+    pio_sim_media_t media = {
+        .enabled = true, .seed = 5, .jitter = 1,
+        .weak = {{
+            .track = 20, .side = 0,
+            .start_permille = 0, .length_permille = 1000,
+            .spread = 2, .dropout_ppm = 120,
+        }},
+        .weak_count = 1,
+    };
+    setup_media_disk(&media);
+
+    floppy_status_t st;
+    for (int s = 1; s <= 4; s++) {
+        read_sector_revs(20, 0, s, &st);
+        ASSERT_EQ(st, FLOPPY_OK);
+    }
+
+    const floppy_history_t *h = floppy_track_history(&floppy, 20, 0);
+    uint8_t sector_revs = h->revs[FLOPPY_OP_SECTOR];
+    ASSERT(sector_revs > 0);
+    ASSERT_EQ(h->revs[FLOPPY_OP_TRACK], 0);
+
+    double revs;
+    int found = read_track_count(20, 0, &revs);
+    printf("\n  Sector read budget from %u revolutions, track read %d/18 in %.2f revolutions (%u learned)\n  ",
+           sector_revs, found, revs, h->revs[FLOPPY_OP_TRACK]);
+    ASSERT_EQ(found, SECTORS_PER_TRACK);
+    ASSERT_EQ(h->fail[FLOPPY_RECOVER_READ], 0);
+    ASSERT(h->revs[FLOPPY_OP_TRACK] > sector_revs * 2 + 1);
+    ASSERT_EQ(h->revs[FLOPPY_OP_SECTOR], sector_revs);
+}
+
+static pio_sim_media_t dead_sectors_media(uint16_t length_permille) {
+    return (pio_sim_media_t){
+        .enabled = true, .seed = 12, .jitter = 1,
+        .weak = {{
+            .track = 1, .side = 0,
+            .start_permille = 300, .length_permille = length_permille,
+            .spread = 40, .dropout_ppm = 5000,
+        }},
+        .weak_count = 1,
+    };
+}
+
+TEST(test_archive_overhead_vs_recovery) {
+    pio_sim_media_t one_dead = dead_sectors_media(25);
+    pio_sim_media_t two_dead = dead_sectors_media(60);
+    static f12_t fs;
+    double clean_revs[3], one_revs[3], two_revs[3];
+    bool clean_ok[3], one_ok[3], two_ok[3];
+    uint32_t rebuilt[3];
+
+    for (uint8_t level = 0; level <= 2; level++) {
+        setup_archive_disk(level, NULL, ARCHIVE_FILE_SIZE);
+        memset(&fs, 0, sizeof(fs));
+        clean_ok[level] = read_archive_file(&fs, &clean_revs[level]);
+        f12_unmount(&fs);
+
+        setup_archive_disk(level, &one_dead, ARCHIVE_FILE_SIZE);
+        memset(&fs, 0, sizeof(fs));
+        one_ok[level] = read_archive_file(&fs, &one_revs[level]);
+        rebuilt[level] = fs.archive.stats.rebuilt;
+        f12_unmount(&fs);
+
+        setup_archive_disk(level, &two_dead, ARCHIVE_FILE_SIZE);
+        memset(&fs, 0, sizeof(fs));
+        two_ok[level] = read_archive_file(&fs, &two_revs[level]);
+        f12_unmount(&fs);
+
+        printf("\n  level %d: %4.1f%% capacity, clean %.2f revs, 1 dead %s %.2f revs, 2 dead %s %.2f revs",
+               level, f12_archive_cylinders(level) * 100.0 / FLOPPY_TRACKS, clean_revs[level],
+               one_ok[level] ? "ok" : "FAIL", one_revs[level],
+               two_ok[level] ? "ok" : "FAIL", two_revs[level]);
+    }
+    printf("\n  ");
+
+    for (int level = 0; level <= 2; level++) {
+        ASSERT(clean_ok[level]);
+        ASSERT(clean_revs[level] < clean_revs[0] + 1.5);
+    }
+    ASSERT(!one_ok[0]);
+    ASSERT(!two_ok[0]);
+    ASSERT(one_ok[1]);
+    ASSERT(one_ok[2]);
+    ASSERT_EQ(rebuilt[1], 1);
+    ASSERT(one_revs[1] * 5 < one_revs[0]);
+    ASSERT(!two_ok[1]);
+    ASSERT(two_ok[2]);
+    ASSERT(two_revs[2] * 5 < two_revs[0]);
+}
+
+static bool write_next_to_dead_sector(uint8_t level, double *revs, uint32_t *rebuilt) {
+    pio_sim_media_t faded = dead_sectors_media(25);
+    faded.weak[0].write_heals = true;
+    setup_archive_disk(level, &faded, 11 * SECTOR_SIZE);
+
+    static f12_t fs;
+    memset(&fs, 0, sizeof(fs));
+    f12_io_t io = {
+        .read = floppy_io_read,
+        .read_quick = floppy_io_read_quick,
+        .read_track = floppy_io_read_track,
+        .write = floppy_io_write,
+        .set_sink = floppy_io_set_sink,
+        .ctx = &floppy,
+    };
+    double before = sim_drive.revolutions;
+    bool ok = f12_mount(&fs, io) == F12_OK;
+    f12_file_t *f = ok ? f12_open(&fs, "NEW.BIN", "w") : NULL;
+    uint8_t buf[SECTOR_SIZE];
+    for (uint32_t off = 0; f && off < 10 * SECTOR_SIZE; off += sizeof(buf)) {
+        for (uint32_t i = 0; i < sizeof(buf); i++) buf[i] = archive_byte(off + i) ^ 0x5A;
+        if (f12_write(f, buf, sizeof(buf)) != (int)sizeof(buf)) ok = false;
+    }
+    ok = f && ok && f12_close(f) == F12_OK;
+    f = ok ? f12_open(&fs, "NEW.BIN", "r") : NULL;
+    ok = f != NULL;
+    for (uint32_t off = 0; ok && off < 10 * SECTOR_SIZE; off += sizeof(buf)) {
+        ok = f12_read(f, buf, sizeof(buf)) == (int)sizeof(buf);
+        for (uint32_t i = 0; ok && i < sizeof(buf); i++) ok = buf[i] == (archive_byte(off + i) ^ 0x5A);
+    }
+    if (f) f12_close(f);
+    *rebuilt = fs.archive.stats.rebuilt;
+    f12_unmount(&fs);
+    *revs = sim_drive.revolutions - before;
+    return ok;
+}
+
+TEST(test_archive_write_next_to_dead_sector) {
+    double plain_revs, archive_revs;
+    uint32_t plain_rebuilt, archive_rebuilt;
+    bool plain = write_next_to_dead_sector(0, &plain_revs, &plain_rebuilt);
+    bool archived = write_next_to_dead_sector(1, &archive_revs, &archive_rebuilt);
+
+    printf("\n  write beside a dead sector: level 0 %s in %.2f revs, level 1 %s in %.2f revs (%u rebuilt)\n  ",
+           plain ? "ok" : "FAIL", plain_revs, archived ? "ok" : "FAIL", archive_revs, archive_rebuilt);
+    ASSERT(!plain);
+    ASSERT(archived);
+    ASSERT(archive_rebuilt >= 1);
+    ASSERT(archive_revs < plain_revs);
+}
+
+int main(void) {
+    printf("=== PIO Media Model Tests ===\n\n");
+
+    RUN_TEST(test_media_disabled_is_exact);
+    RUN_TEST(test_media_jitter_differs_per_revolution);
+    RUN_TEST(test_media_peak_shift_grows_inward);
+    RUN_TEST(test_media_wobble);
+    RUN_TEST(test_media_weak_region_policies);
+    RUN_TEST(test_media_weak_count_clamped);
+    RUN_TEST(test_media_precomp_recovers_inner_write);
+    RUN_TEST(test_adaptive_offcenter_track);
+    RUN_TEST(test_adaptive_history_per_track);
+    RUN_TEST(test_adaptive_budget_per_operation);
+    RUN_TEST(test_archive_overhead_vs_recovery);
+    RUN_TEST(test_archive_write_next_to_dead_sector);
+
+    pio_sim_free(&sim_drive);
+
+    TEST_RESULTS();
+}
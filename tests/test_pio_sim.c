@@ -158,6 +158,141 @@ TEST(test_pio_f12_read_file) {
     f12_unmount(&fs);
 }
 
+TEST(test_pio_multi_revolution) {
+    setup_floppy();
+
+    ASSERT_EQ(sim_drive.tracks[0][0].num_revs, 3);
+
+    uint32_t seq = sim_drive.rev_seq;
+    double revs = sim_drive.revolutions;
+    int ok = 0;
+    for (int i = 0; i < 3; i++) {
+        sector_t sector = { .track = 0, .side = 0, .sector_n = SECTORS_PER_TRACK };
+        if (floppy_read_sector(&floppy, &sector) == FLOPPY_OK) ok++;
+    }
+
+    printf("\n  Sector 18 read from %u revolutions in rotation: %d/3, %.2f revolutions spent\n  ",
+           sim_drive.rev_seq - seq, ok, sim_drive.revolutions - revs);
+    ASSERT_EQ(ok, 3);
+    ASSERT(sim_drive.rev_seq - seq >= 3);
+}
+
+static double sink_workload(bool sink, uint32_t *reads, uint32_t *cached) {
+    setup_floppy();
+
+    f12_io_t io = {
+        .read = floppy_io_read,
+        .write = floppy_io_write,
+        .disk_changed = floppy_io_disk_changed,
+        .write_protected = floppy_io_write_protected,
+        .set_sink = sink ? floppy_io_set_sink : NULL,
+        .ctx = &floppy,
+    };
+
+    f12_t fs;
+    memset(&fs, 0, sizeof(fs));
+    ASSERT_EQ(f12_mount(&fs, io), F12_OK);
+
+    sector_t dump = { .track = 1, .side = 0, .sector_n = SECTORS_PER_TRACK };
+    ASSERT_EQ(floppy_read_sector(&floppy, &dump), FLOPPY_OK);
+
+    double revs = sim_drive.revolutions;
+    uint32_t before = floppy.seek_stats.seeks;
+    for (int n = 1; n <= SECTORS_PER_TRACK; n++) {
+        sector_t s = { .track = 1, .side = 0, .sector_n = n };
+        ASSERT(fs.fat.io.read(fs.fat.io.ctx, &s));
+        ASSERT(s.valid);
+    }
+    *reads = floppy.seek_stats.seeks - before;
+    *cached = lru_count(fs.cache);
+    revs = sim_drive.revolutions - revs;
+
+    f12_unmount(&fs);
+    ASSERT(floppy.sink == NULL);
+    return revs;
+}
+
+TEST(test_pio_sink_fills_cache) {
+    uint32_t plain_reads, plain_cached, sink_reads, sink_cached;
+    double plain = sink_workload(false, &plain_reads, &plain_cached);
+    ASSERT_EQ(floppy.sunk, 0);
+    double sunk = sink_workload(true, &sink_reads, &sink_cached);
+
+    printf("\n  Dump sector 18 then read track 1 through f12:"
+           "\n    without sink: %u drive reads, %.2f revolutions, %u sectors cached"
+           "\n    with sink:    %u drive reads, %.2f revolutions, %u sectors cached (%u offered)\n  ",
+           plain_reads, plain, plain_cached, sink_reads, sunk, sink_cached, floppy.sunk);
+    ASSERT(sink_cached > plain_cached);
+    ASSERT(sink_reads < plain_reads);
+    ASSERT(sunk < plain);
+}
+
+static uint32_t park_workload(floppy_park_t policy, floppy_seek_stats_t *out) {
+    setup_floppy();
+    floppy.park_policy = policy;
+
+    uint32_t seed = 7;
+    uint32_t failed = 0;
+    for (int i = 0; i < 120; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t r = (seed >> 16) % 100;
+        uint8_t track = r < 25 ? (r & 1) : 30 + r % 20;
+        sector_t sector = { .track = track, .side = 0, .sector_n = 1 + r % SECTORS_PER_TRACK };
+        if (floppy_read_sector(&floppy, &sector) != FLOPPY_OK) failed++;
+        floppy_park(&floppy);
+    }
+    *out = floppy.seek_stats;
+    return failed;
+}
+
+TEST(test_pio_park_median_saves_seeks) {
+    floppy_seek_stats_t stay, track0, median;
+    ASSERT_EQ(park_workload(FLOPPY_PARK_STAY, &stay), 0);
+    ASSERT_EQ(park_workload(FLOPPY_PARK_TRACK0, &track0), 0);
+    ASSERT_EQ(park_workload(FLOPPY_PARK_MEDIAN, &median), 0);
+
+    printf("\n  Mean seek: stay %.2f, track0 %.2f, median %.2f tracks (saved %d steps, parked %u steps)\n  ",
+           (double)stay.seek_steps / stay.seeks,
+           (double)track0.seek_steps / track0.seeks,
+           (double)median.seek_steps / median.seeks,
+           median.saved_steps, median.park_steps);
+    ASSERT_EQ(stay.parks, 0);
+    ASSERT_EQ(median.seeks, 120);
+    ASSERT(median.seek_steps < stay.seek_steps);
+    ASSERT(median.seek_steps < track0.seek_steps);
+    ASSERT(median.saved_steps > 0);
+    ASSERT(track0.saved_steps < 0);
+}
+
+TEST(test_pio_park_target_decays) {
+    setup_floppy();
+    floppy.park_policy = FLOPPY_PARK_MEDIAN;
+    ASSERT_EQ(floppy_park_target(&floppy), floppy.track);
+
+    for (int i = 0; i < 20; i++) {
+        sector_t sector = { .track = 10, .side = 0, .sector_n = 1 };
+        ASSERT_EQ(floppy_read_sector(&floppy, &sector), FLOPPY_OK);
+    }
+    ASSERT_EQ(floppy_park_target(&floppy), 10);
+    ASSERT_EQ(floppy_park(&floppy), FLOPPY_OK);
+    ASSERT(floppy.parked);
+    ASSERT_EQ(floppy_current_track(&floppy), 10);
+
+    for (int i = 0; i < FLOPPY_PARK_DECAY_AT; i++) floppy.access[60]++, floppy.access_total++;
+    for (int i = 0; i < 8; i++) {
+        sector_t sector = { .track = 60, .side = 0, .sector_n = 1 };
+        ASSERT_EQ(floppy_read_sector(&floppy, &sector), FLOPPY_OK);
+    }
+    ASSERT(floppy.access_total <= FLOPPY_PARK_DECAY_AT);
+    ASSERT_EQ(floppy_park_target(&floppy), 60);
+
+    floppy.park_policy = FLOPPY_PARK_STAY;
+    ASSERT(!floppy_idle(&floppy));
+    floppy_reset_access(&floppy);
+    floppy.park_policy = FLOPPY_PARK_MEDIAN;
+    ASSERT_EQ(floppy_park_target(&floppy), floppy.track);
+}
+
 int main(void) {
     size_t scp_size;
     uint8_t *scp_data = load_file(SCP_PATH, &scp_size);
@@ -177,6 +312,10 @@ int main(void) {
     RUN_TEST(test_pio_read_all_track0);
     RUN_TEST(test_pio_f12_mount_and_list);
     RUN_TEST(test_pio_f12_read_file);
+    RUN_TEST(test_pio_multi_revolution);
+    RUN_TEST(test_pio_sink_fills_cache);
+    RUN_TEST(test_pio_park_median_saves_seeks);
+    RUN_TEST(test_pio_park_target_decays);
 
     pio_sim_free(&sim_drive);
     free(scp_data);
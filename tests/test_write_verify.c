@@ -5,6 +5,7 @@
 #include "../src/floppy.h"
 #include "../src/fat12.h"
 #include "../src/f12.h"
+#include "../src/mfm_decode.h"
 
 floppy_t *pio_sim_floppy_ref;
 
@@ -187,6 +188,130 @@ TEST(test_write_verify_permanent_fail) {
     f12_unmount(&fs);
 }
 
+static void fill_track(track_t *t, uint8_t track, uint8_t side, uint8_t seed) {
+    memset(t, 0, sizeof(*t));
+    t->track = track;
+    t->side = side;
+    for (int s = 0; s < SECTORS_PER_TRACK; s++) {
+        t->sectors[s].track = track;
+        t->sectors[s].side = side;
+        t->sectors[s].sector_n = s + 1;
+        t->sectors[s].size_code = 2;
+        t->sectors[s].valid = true;
+        for (int i = 0; i < SECTOR_SIZE; i++) {
+            t->sectors[s].data[i] = (uint8_t)(seed + s * 17 + i * 3);
+        }
+    }
+}
+
+static int count_stored_sectors(uint8_t track, uint8_t side, const track_t *expected,
+                                int *mismatches) {
+    pio_sim_track_t *st = &sim_drive.tracks[track][side];
+    mfm_t mfm;
+    mfm_init(&mfm);
+    sector_t out;
+    int found = 0;
+    *mismatches = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < st->counts[0]; i++) {
+            if (!mfm_feed(&mfm, st->revs[0][i], &out) || !out.valid) continue;
+            if (pass == 0) continue;
+            found++;
+            if (memcmp(out.data, expected->sectors[out.sector_n - 1].data, SECTOR_SIZE) != 0)
+                (*mismatches)++;
+        }
+    }
+    return found;
+}
+
+TEST(test_index_free_write) {
+    setup_formatted_disk();
+    floppy.index_free_write = true;
+
+    f12_t fs;
+    memset(&fs, 0, sizeof(fs));
+    ASSERT_EQ(f12_mount(&fs, make_floppy_io()), F12_OK);
+
+    uint32_t polls = sim_drive.index_poll_count;
+    f12_file_t *f = f12_open(&fs, "SPLICE.TXT", "w");
+    ASSERT(f != NULL);
+    const char *msg = "Written at whatever angle the head happened to be at.";
+    ASSERT_EQ(f12_write(f, msg, strlen(msg)), (int)strlen(msg));
+    ASSERT_EQ(f12_close(f), F12_OK);
+    ASSERT_EQ(sim_drive.index_poll_count, polls);
+
+    f12_unmount(&fs);
+    ASSERT_EQ(f12_mount(&fs, make_floppy_io()), F12_OK);
+    f = f12_open(&fs, "SPLICE.TXT", "r");
+    ASSERT(f != NULL);
+    char buf[128];
+    ASSERT_EQ(f12_read(f, buf, sizeof(buf)), (int)strlen(msg));
+    ASSERT_MEM_EQ(buf, msg, strlen(msg));
+    f12_close(f);
+    f12_unmount(&fs);
+}
+
+TEST(test_index_free_covers_track) {
+    setup_formatted_disk();
+    floppy.index_free_write = true;
+
+    static track_t t;
+    for (uint8_t sector_n = 1; sector_n <= SECTORS_PER_TRACK; sector_n += 5) {
+        sector_t probe = {.track = 30, .side = 1, .sector_n = sector_n};
+        ASSERT_EQ(floppy_read_sector(&floppy, &probe), FLOPPY_OK);
+
+        fill_track(&t, 30, 1, sector_n);
+        uint32_t polls = sim_drive.index_poll_count;
+        ASSERT_EQ(floppy_write_track(&floppy, &t), FLOPPY_OK);
+        ASSERT_EQ(sim_drive.index_poll_count, polls);
+
+        int mismatches;
+        ASSERT_EQ(count_stored_sectors(30, 1, &t, &mismatches), SECTORS_PER_TRACK);
+        ASSERT_EQ(mismatches, 0);
+    }
+}
+
+TEST(test_index_free_rotates_after_read) {
+    setup_formatted_disk();
+    floppy.index_free_write = true;
+
+    static track_t t;
+    fill_track(&t, 12, 0, 99);
+    t.sectors[4].valid = false;
+
+    ASSERT_EQ(floppy_write_track(&floppy, &t), FLOPPY_OK);
+
+    pio_sim_track_t *st = &sim_drive.tracks[12][0];
+    mfm_t mfm;
+    mfm_init(&mfm);
+    sector_t out;
+    int first = 0;
+    for (uint32_t i = 0; i < st->counts[0] && !first; i++) {
+        if (mfm_feed(&mfm, st->revs[0][i], &out) && out.valid) first = out.sector_n;
+    }
+    ASSERT(first != 0 && first != 1);
+}
+
+static double stale_retry_revolutions(bool index_free) {
+    setup_formatted_disk();
+    floppy.index_free_write = index_free;
+    sim_drive.fault_writes_remaining = 1;
+
+    static track_t t;
+    fill_track(&t, 50, 0, 7);
+    double before = sim_drive.revolutions;
+    ASSERT_EQ(floppy_write_track(&floppy, &t), FLOPPY_OK);
+    ASSERT_EQ(sim_drive.fault_writes_remaining, 0);
+    return sim_drive.revolutions - before;
+}
+
+TEST(test_index_free_stale_detect) {
+    double aligned = stale_retry_revolutions(false);
+    double index_free = stale_retry_revolutions(true);
+    printf("(retry after dropped write: %.2f vs %.2f revolutions) ", index_free, aligned);
+    ASSERT(index_free < aligned);
+}
+
 int main(void) {
     printf("=== Write Verification Tests ===\n\n");
 
@@ -195,6 +320,12 @@ int main(void) {
     RUN_TEST(test_write_verify_retry);
     RUN_TEST(test_write_verify_permanent_fail);
 
+    printf("\n--- Index-Free Writes ---\n");
+    RUN_TEST(test_index_free_write);
+    RUN_TEST(test_index_free_covers_track);
+    RUN_TEST(test_index_free_rotates_after_read);
+    RUN_TEST(test_index_free_stale_detect);
+
     pio_sim_free(&sim_drive);
 
     TEST_RESULTS();